@@ -29,6 +29,7 @@ void PApp_Signal (const Proxy* pp, unsigned sig, pid_t childPid, int childStatus
     casystm_write_uint32 (&os, sig);
     casystm_write_uint32 (&os, childPid);
     casystm_write_int32 (&os, childStatus);
+    msg->priority = priority_High;	// Signals must not wait behind bulk traffic
     casymsg_end (msg);
 }
 
@@ -0,0 +1,38 @@
+################ Source files ##########################################
+
+bench/SRCS	:= $(wildcard bench/*.c)
+bench/BENCHES	:= $(addprefix $O,$(bench/SRCS:.c=))
+bench/OBJS	:= $(addprefix $O,$(bench/SRCS:.c=.o))
+bench/DEPS	:= ${bench/OBJS:.o=.d}
+
+################ Compilation ###########################################
+
+.PHONY:	bench bench/all bench/run bench/clean
+
+bench/all:	${bench/BENCHES}
+
+# Benchmarks print timings, so their output is not checked
+#
+bench:		bench/run
+bench/run:	${bench/BENCHES}
+	@for i in ${bench/BENCHES}; do \
+	    echo "Running bench/$$(basename $$i)";\
+	    $$i;\
+	done
+
+${bench/BENCHES}: $Obench/%: $Obench/%.o ${LIBA}
+	@echo "Linking $@ ..."
+	@${CC} ${LDFLAGS} -o $@ $^
+
+################ Maintenance ###########################################
+
+clean:	bench/clean
+bench/clean:
+	@if [ -d $Obench ]; then\
+	    rm -f ${bench/BENCHES} ${bench/OBJS} ${bench/DEPS} $Obench/.d;\
+	    rmdir ${BUILDDIR}/bench;\
+	fi
+
+${bench/OBJS}: Makefile bench/Module.mk ${CONFS} $Obench/.d config.h
+
+-include ${bench/DEPS}
@@ -0,0 +1,128 @@
+// This file is part of the casycom project
+//
+// Copyright (c) 2015 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "../main.h"
+#include "../vector.h"
+#include <pthread.h>
+#include <time.h>
+
+//----------------------------------------------------------------------
+// Measures output queue contention with several producer threads
+// feeding one consumer. The spinlocked vector is the queue design used
+// by casycom_queue_message before the lock-free MsgQueue replaced it.
+
+enum {
+    c_DefaultProducers	= 4,
+    c_MessagesPerProducer = 1000000
+};
+
+DECLARE_VECTOR_TYPE (MsgVector, Msg*);
+
+static unsigned _nProducers = c_DefaultProducers;
+static Msg* _msgs = NULL;
+static _Atomic(unsigned) _nStarted = 0;
+
+// Spinlocked vector queue
+static _Atomic(bool) _lockedQueueLock = false;
+static VECTOR (MsgVector, _lockedQueue);
+
+// Lock-free queue
+static MsgQueue _freeQueue = NULL;
+
+//----------------------------------------------------------------------
+
+static uint64_t NowNS (void)
+{
+    struct timespec t;
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+static void WaitForStart (void)
+{
+    ++_nStarted;
+    while (_nStarted <= _nProducers)
+	tight_loop_pause();
+}
+
+static void* LockedProducer (void* arg)
+{
+    Msg* msgs = arg;
+    WaitForStart();
+    for (unsigned i = 0; i < c_MessagesPerProducer; ++i) {
+	Msg* msg = &msgs[i];
+	acquire_lock (&_lockedQueueLock);
+	vector_push_back (&_lockedQueue, &msg);
+	release_lock (&_lockedQueueLock);
+    }
+    return NULL;
+}
+
+static size_t LockedConsume (MsgVector* inq)
+{
+    acquire_lock (&_lockedQueueLock);
+    vector_swap (inq, &_lockedQueue);
+    release_lock (&_lockedQueueLock);
+    size_t n = inq->size;
+    vector_clear (inq);
+    return n;
+}
+
+static void* FreeProducer (void* arg)
+{
+    Msg* msgs = arg;
+    WaitForStart();
+    for (unsigned i = 0; i < c_MessagesPerProducer; ++i)
+	casymsg_queue_push (&_freeQueue, &msgs[i]);
+    return NULL;
+}
+
+static size_t FreeConsume (MsgVector* inq)
+{
+    Msg* l = casymsg_queue_take (&_freeQueue);
+    size_t n = 0;
+    for (const Msg* m = l; m; m = m->next)
+	++n;
+    vector_resize (inq, n);
+    for (size_t i = n; l; l = l->next)
+	inq->d[--i] = l;
+    vector_clear (inq);
+    return n;
+}
+
+static void RunBenchmark (const char* name, void* (*producer)(void*), size_t (*consume)(MsgVector*))
+{
+    _nStarted = 0;
+    pthread_t threads [_nProducers];
+    for (unsigned i = 0; i < _nProducers; ++i)
+	pthread_create (&threads[i], NULL, producer, &_msgs[i*c_MessagesPerProducer]);
+    WaitForStart();
+    const uint64_t start = NowNS();
+    VECTOR (MsgVector, inq);
+    const size_t total = (size_t) _nProducers * c_MessagesPerProducer;
+    size_t nReceived = 0, nRounds = 0;
+    for (; nReceived < total; ++nRounds)
+	nReceived += consume (&inq);
+    const uint64_t elapsed = NowNS() - start;
+    for (unsigned i = 0; i < _nProducers; ++i)
+	pthread_join (threads[i], NULL);
+    vector_deallocate (&inq);
+    printf ("%-10s %u producers: %zu messages in %zu rounds, %.1f ms, %.1f ns/msg\n",
+	    name, _nProducers, total, nRounds, elapsed/1e6, (double) elapsed/total);
+}
+
+int main (int argc, char* const* argv)
+{
+    if (argc > 1)
+	_nProducers = strtoul (argv[1], NULL, 10);
+    if (!_nProducers)
+	_nProducers = c_DefaultProducers;
+    _msgs = xalloc (sizeof(Msg) * _nProducers * c_MessagesPerProducer);
+    RunBenchmark ("spinlock", LockedProducer, LockedConsume);
+    RunBenchmark ("lock-free", FreeProducer, FreeConsume);
+    vector_deallocate (&_lockedQueue);
+    free (_msgs);
+    return EXIT_SUCCESS;
+}
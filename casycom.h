@@ -8,4 +8,5 @@
 #include "casycom/app.h"
 #include "casycom/timer.h"
 #include "casycom/io.h"
+#include "casycom/child.h"
 #include "casycom/xsrv.h"
@@ -0,0 +1,246 @@
+// This file is part of the casycom project
+//
+// Copyright (c) 2015 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "child.h"
+#include "timer.h"
+#include "vector.h"
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <pthread.h>
+
+//{{{ Watched child registry -------------------------------------------
+//
+// The SIGCHLD reaper in the App shard and the Child objects in any
+// shard may both reap a watched child. Whichever gets there first
+// records the status here, so the exit is delivered only to the
+// object that watches the child, and only once.
+
+typedef struct _ChildWait {
+    pid_t	pid;
+    int		status;
+    bool	reaped;
+} ChildWait;
+
+DECLARE_VECTOR_TYPE (ChildWaitVector, ChildWait);
+
+static ChildWaitVector _child_Watched = VECTOR_INIT (ChildWaitVector);
+// A mutex, since waitpid, waitid and pidfd_open are called under it
+static pthread_mutex_t _child_Lock = PTHREAD_MUTEX_INITIALIZER;
+
+static ChildWait* Child_Find (pid_t pid)
+{
+    vector_foreach (ChildWait, w, _child_Watched)
+	if (w->pid == pid)
+	    return w;
+    return NULL;
+}
+
+// Registered when the watch is sent, so the exit is not taken by
+// the reaper as an unwatched child before the Child object runs.
+static void Child_Register (pid_t pid)
+{
+    pthread_mutex_lock (&_child_Lock);
+    if (!Child_Find (pid)) {
+	ChildWait* w = vector_emplace_back (&_child_Watched);
+	w->pid = pid;
+    }
+    pthread_mutex_unlock (&_child_Lock);
+}
+
+pid_t Child_WaitAny (int* status)
+{
+    pid_t pid;
+    pthread_mutex_lock (&_child_Lock);
+    while (0 < (pid = waitpid (-1, status, WNOHANG))) {
+	ChildWait* w = Child_Find (pid);
+	if (!w)
+	    break;
+	DEBUG_PRINTF ("[C] Reaped watched child %d\n", pid);
+	w->status = *status;
+	w->reaped = true;
+    }
+    pthread_mutex_unlock (&_child_Lock);
+    return pid > 0 ? pid : 0;
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ Child interface
+
+enum { method_Child_Watch };
+
+void PChild_Watch (const Proxy* pp, pid_t pid)
+{
+    assert (pp->interface == &i_Child && "this proxy is for a different interface");
+    Child_Register (pid);
+    Msg* msg = casymsg_begin (pp, method_Child_Watch, 4);
+    WStm os = casymsg_write (msg);
+    casystm_write_int32 (&os, pid);
+    casymsg_end (msg);
+}
+
+static void Child_Dispatch (const DChild* dtable, void* o, const Msg* msg)
+{
+    if (msg->imethod == method_Child_Watch) {
+	RStm is = casymsg_read (msg);
+	pid_t pid = casystm_read_int32 (&is);
+	dtable->Child_Watch (o, pid);
+    } else
+	casymsg_default_dispatch (dtable, o, msg);
+}
+
+const Interface i_Child = {
+    .name	= "Child",
+    .dispatch	= Child_Dispatch,
+    .method	= { "Watch\0i", NULL }
+};
+
+//}}}-------------------------------------------------------------------
+//{{{ ChildR interface
+
+enum { method_ChildR_Exited };
+
+void PChildR_Exited (const Proxy* pp, pid_t pid, int status)
+{
+    assert (pp->interface == &i_ChildR && "this proxy is for a different interface");
+    Msg* msg = casymsg_begin (pp, method_ChildR_Exited, 8);
+    WStm os = casymsg_write (msg);
+    casystm_write_int32 (&os, pid);
+    casystm_write_int32 (&os, status);
+    casymsg_end (msg);
+}
+
+static void ChildR_Dispatch (const DChildR* dtable, void* o, const Msg* msg)
+{
+    if (msg->imethod == method_ChildR_Exited) {
+	RStm is = casymsg_read (msg);
+	pid_t pid = casystm_read_int32 (&is);
+	int status = casystm_read_int32 (&is);
+	if (dtable->ChildR_Exited)
+	    dtable->ChildR_Exited (o, pid, status);
+    } else
+	casymsg_default_dispatch (dtable, o, msg);
+}
+
+const Interface i_ChildR = {
+    .name	= "ChildR",
+    .dispatch	= ChildR_Dispatch,
+    .method	= { "Exited\0ii", NULL }
+};
+
+//}}}-------------------------------------------------------------------
+//{{{ Child object
+
+typedef struct _Child {
+    Proxy	reply;
+    Proxy	timer;
+    pid_t	pid;
+    int		pidfd;
+} Child;
+
+static void* Child_Create (const Msg* msg)
+{
+    Child* o = xalloc (sizeof(Child));
+    o->pidfd = -1;
+    o->reply = casycom_create_reply_proxy (&i_ChildR, msg);
+    o->timer = casycom_create_proxy (&i_Timer, msg->h.dest);
+    return o;
+}
+
+static void Child_Unwatch (Child* o)
+{
+    if (o->pidfd >= 0) {
+	close (o->pidfd);
+	o->pidfd = -1;
+    }
+    if (!o->pid)
+	return;
+    pthread_mutex_lock (&_child_Lock);
+    ChildWait* w = Child_Find (o->pid);
+    if (w)
+	vector_erase (&_child_Watched, vector_p2i (&_child_Watched, w));
+    pthread_mutex_unlock (&_child_Lock);
+    o->pid = 0;
+}
+
+static void Child_Destroy (void* vo)
+{
+    Child* o = vo;
+    Child_Unwatch (o);
+    xfree (o);
+}
+
+static void Child_Exited (Child* o, int status)
+{
+    const pid_t pid = o->pid;
+    DEBUG_PRINTF ("[C] Child %d exited with status %d\n", pid, status);
+    Child_Unwatch (o);
+    PChildR_Exited (&o->reply, pid, status);
+    casycom_mark_unused (o);
+}
+
+static void Child_Child_Watch (Child* o, pid_t pid)
+{
+    assert (!o->pid && "each Child object watches only one process");
+    o->pid = pid;
+    pthread_mutex_lock (&_child_Lock);
+    ChildWait* w = Child_Find (pid);
+    if (w && w->reaped) {	// already exited and reaped by SIGCHLD
+	int status = w->status;
+	pthread_mutex_unlock (&_child_Lock);
+	return Child_Exited (o, status);
+    }
+    // Opened under the lock, while the child can not be reaped
+    o->pidfd = syscall (SYS_pidfd_open, pid, 0);
+    pthread_mutex_unlock (&_child_Lock);
+    if (o->pidfd < 0 && errno == ESRCH)	// reaped as unwatched before the watch was sent
+	return Child_Exited (o, -1);
+    if (o->pidfd < 0)
+	return casycom_error ("pidfd_open %d: %s", pid, strerror(errno));
+    DEBUG_PRINTF ("[C] Watching child %d on pidfd %d\n", pid, o->pidfd);
+    PTimer_WaitRead (&o->timer, o->pidfd);
+}
+
+// The pidfd becomes readable when the process exits. All pidfds that
+// are ready are returned by the same poll, so a batch of exits is
+// reaped in one pass through the timer watch list.
+static void Child_TimerR_Timer (Child* o, int fd UNUSED, const Msg* msg UNUSED)
+{
+    int status = -1;
+    pthread_mutex_lock (&_child_Lock);
+    ChildWait* w = Child_Find (o->pid);
+    if (w && w->reaped)
+	status = w->status;
+    else {
+	siginfo_t si = {};
+	if (0 > waitid (P_PIDFD, o->pidfd, &si, WEXITED| WNOHANG)) {
+	    if (errno != ECHILD)
+		casycom_error ("waitid %d: %s", o->pid, strerror(errno));
+	} else if (si.si_pid != o->pid) {
+	    pthread_mutex_unlock (&_child_Lock);
+	    return PTimer_WaitRead (&o->timer, o->pidfd);	// not exited yet
+	} else if (si.si_code == CLD_EXITED)
+	    status = W_EXITCODE (si.si_status, 0);
+	else
+	    status = W_EXITCODE (0, si.si_status)| (si.si_code == CLD_DUMPED ? WCOREFLAG : 0);
+    }
+    pthread_mutex_unlock (&_child_Lock);
+    Child_Exited (o, status);
+}
+
+static const DChild d_Child_Child = {
+    .interface	= &i_Child,
+    DMETHOD (Child, Child_Watch)
+};
+static const DTimerR d_Child_TimerR = {
+    .interface	= &i_TimerR,
+    DMETHOD (Child, TimerR_Timer)
+};
+const Factory f_Child = {
+    .Create	= Child_Create,
+    .Destroy	= Child_Destroy,
+    .dtable	= { &d_Child_Child, &d_Child_TimerR, NULL }
+};
+
+//}}}-------------------------------------------------------------------
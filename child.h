@@ -0,0 +1,58 @@
+// This file is part of the casycom project
+//
+// Copyright (c) 2015 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#pragma once
+#include "main.h"
+#include <sys/types.h>
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//----------------------------------------------------------------------
+// Child process watch. Each Child object watches one launched process
+// through a pidfd in the timer poll set, and reaps it when it exits.
+
+typedef void (*MFN_Child_Watch)(void* o, pid_t pid);
+typedef struct _DChild {
+    const Interface*	interface;
+    MFN_Child_Watch	Child_Watch;
+} DChild;
+
+// Watch the given child process. Its exit is sent with PChildR_Exited
+// instead of as an App Signal. Call right after the fork. If another
+// loop reaps the child as unwatched before then, the status is -1.
+void PChild_Watch (const Proxy* pp, pid_t pid) noexcept NONNULL();
+
+extern const Interface i_Child;
+
+//----------------------------------------------------------------------
+// Notifications from the Child interface
+
+typedef void (*MFN_ChildR_Exited)(void* o, pid_t pid, int status);
+typedef struct _DChildR {
+    const Interface*	interface;
+    MFN_ChildR_Exited	ChildR_Exited;
+} DChildR;
+
+// Sent when the watched child exits, with the waitpid status,
+// or -1 if the child was reaped by someone else.
+void PChildR_Exited (const Proxy* pp, pid_t pid, int status) noexcept NONNULL();
+
+extern const Interface i_ChildR;
+
+//----------------------------------------------------------------------
+
+extern const Factory f_Child;
+
+// Reaps exited children, keeping the status of watched ones for their
+// Child objects. Returns the first unwatched child, or 0 if none.
+// Used by the SIGCHLD handler; do not call directly.
+pid_t Child_WaitAny (int* status) noexcept NONNULL();
+
+//----------------------------------------------------------------------
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
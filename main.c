@@ -5,39 +5,149 @@
 
 #include "app.h"
 #include "timer.h"
+#include "child.h"
 #include "vector.h"
 #include <signal.h>
 #include <stdarg.h>
 #include <sys/wait.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <pthread.h>
 
 //{{{ Module globals ---------------------------------------------------
 
 // Last non-fatal signal. Set by signal handler, read by main loop.
-static unsigned _casycom_LastSignal = 0;
-static pid_t _casycom_LastChildPid = 0;
-static int _casycom_LastChildStatus = 0;
-// Loop exit code
-static int _casycom_ExitCode = EXIT_SUCCESS;
+// Atomic, since the handler may run on any shard thread.
+static _Atomic(unsigned) _casycom_LastSignal = 0;
+// Other signals delivered as messages are blocked, and read by the App
+// loop from a signalfd, polled with its other fds, so none are lost.
+static int _casycom_SignalFd = -1;
+static sigset_t _casycom_SignalMask;	// Mask before blocking, for launched children
+// Loop exit code, set by the loop of any shard
+static _Atomic(int) _casycom_ExitCode = EXIT_SUCCESS;
 // Loop status
-static bool _casycom_Quitting = false;
-// Output queue modification lock
-static _Atomic(bool) _casycom_OutputQueueLock = false;
+static _Thread_local bool _casycom_Quitting = false;
 // Last error
-static char* _casycom_Error = NULL;
+static _Thread_local char* _casycom_Error = NULL;
 // App proxy
-static Proxy _casycom_PApp = {};
+static _Thread_local Proxy _casycom_PApp = {};
 // Enables debug trace messages
 bool casycom_DebugMsgTrace = false;
 
+// Each loop thread runs one shard, with its own link map, input queue,
+// and timer list in thread-local variables. Objects are pinned to the
+// shard whose oid range contains their oid. The output queue of each
+// shard is written by any thread; messages to objects in other shards
+// are queued there directly.
+enum { MAX_SHARDS = 64 };
+struct _PoolJob;
+// Messages sent with casymsg_end_at are held until their deadline in a
+// binary heap ordered by deadline, and by sequence for equal deadlines.
+typedef struct _DelayedMsg {
+    casytimer_t	deadline;
+    uint64_t	seq;
+    Msg*	msg;
+} DelayedMsg;
+DECLARE_VECTOR_TYPE (DelayedQueue, DelayedMsg);
+DECLARE_VECTOR_TYPE (OidVector, oid_t);
+typedef struct _LoopShard {
+    _Alignas(64) MsgQueue outq;		// Lock-free output queue, read by the shard loop
+    _Atomic(bool)	sleeping;	// Set while the loop sleeps in poll, to be woken through wakefd
+    int			wakefd;
+    _Atomic(size_t)	nremote;	// Number of oids allocated by other shards, from the top of the range
+    _Atomic(bool)	remotelock;	// Held while modifying remotefree
+    OidVector		remotefree;	// Freed oids from the top of the range, in their next generation
+    _Atomic(struct _PoolJob*) pooldone;	// Jobs finished by the worker pool
+    _Atomic(bool)	delaylock;	// Held while modifying delayed
+    _Atomic(bool)	delaynew;	// Set when another thread adds a message ahead of the others
+    uint64_t		delayseq;
+    DelayedQueue	delayed;	// Messages delayed by this shard's objects
+} LoopShard;
+
+static LoopShard _casycom_Shards [MAX_SHARDS] = {{ .wakefd = -1, .delayed = VECTOR_INIT(DelayedQueue), .remotefree = VECTOR_INIT(OidVector) }};	// Others are initialized when started
+static unsigned _casycom_NShards = 1;
+static size_t _casycom_ShardRange = (size_t) oid_IndexMask + 1;	// Number of oid slots in each shard
+static _Atomic(bool) _casycom_ShardsQuitting = false;
+static _Thread_local LoopShard* _casycom_Shard = NULL;	// Shard of this loop thread, NULL on other threads
+static pfn_shard_init _casycom_ShardInit = NULL;
+static pthread_barrier_t _casycom_ShardsStarted;
+
 // Message queues
 DECLARE_VECTOR_TYPE (MsgVector, Msg*);
-static VECTOR (MsgVector, _casycom_InputQueue);	// During each main loop iteration, this queue is read
-static VECTOR (MsgVector, _casycom_OutputQueue);	// ... and this queue is written. Then they are swapped.
+// During each main loop iteration, the input queue is read and the
+// shard output queue is written. Then the output is moved to input.
+// The input queue has a lane for each message priority. Each lane
+// is read from its cursor, so new messages can be appended mid-round.
+typedef struct _MsgLane {
+    MsgVector	q;
+    size_t	next;	// Index of the next message to deliver
+    size_t	end;	// Messages from next to end are to be delivered in this round
+    size_t	unbatched;	// End of the last run declined by DispatchBatch
+} MsgLane;
+static _Thread_local MsgLane _casycom_InputQueue [priority_Lanes] = {
+    [priority_Normal]	= { .q = VECTOR_INIT(MsgVector) },
+    [priority_High]	= { .q = VECTOR_INIT(MsgVector) }
+};
+// Starvation guard: after this many high priority messages in a row,
+// a normal priority message is delivered if one is waiting.
+enum { MAX_HIGH_PRIORITY_RUN = 32 };
+// Undelivered messages to supersedable methods, sent from this loop,
+// indexed by a hash of their destination and method. A newer message
+// for the same destination and method replaces the pending one in place.
+enum { SUPERSEDE_TABLE_SIZE = 64 };
+static _Thread_local Msg* _casycom_Superseded [SUPERSEDE_TABLE_SIZE];
+// Undelivered messages to interfaces with a quota, for each destination.
+// Written by any sending thread, so only touched for such interfaces.
+static _Atomic(uint32_t) _casycom_Mailbox [(size_t) oid_IndexMask + 1];
+// Dispatch budget of each round. When exhausted, the loop polls fds
+// and timers before delivering the rest. 0 is unlimited.
+static unsigned _casycom_BudgetMessages = 0;
+static unsigned _casycom_BudgetTime = 0;	// in microseconds
+enum { BUDGET_TIME_CHECK_INTERVAL = 16 };	// Messages between clock checks
+// Maximum delivery passes in each round, each delivering the messages
+// sent during the previous pass. 1 delivers them in the next round.
+static unsigned _casycom_DrainPasses = 1;
+// Busy polling. When enabled, an idle loop spins on its queues and
+// zero-timeout fd polls before blocking, for a window adapted to the
+// average idle gap. The window is at most _casycom_BusyPollMax.
+static unsigned _casycom_BusyPollMax = 0;	// in microseconds; 0 is off
+enum { BUSY_POLL_MIN_WINDOW = 8 };		// Shortest worthwhile spin
+static _Thread_local LoopStats _casycom_Stats = {};
 
-// Object table contains object factories and the dtables they support
-DECLARE_VECTOR_TYPE (FactoryTable, const Factory*);
-static VECTOR (FactoryTable, _casycom_ObjectTable);
-static const Factory* _casycom_DefaultObject = NULL;
+// Registered factories are found through the interface index below
+static _Thread_local const Factory* _casycom_DefaultObject = NULL;
+// Each registered factory has a row of its dtables, indexed by the
+// dense interface index assigned at registration. All the interfaces
+// of the factory are indexed by then, so the row never grows.
+DECLARE_VECTOR_TYPE (DTableRow, const DTable*);
+DECLARE_VECTOR_TYPE (DTableRows, DTableRow*);
+static _Thread_local VECTOR (DTableRows, _casycom_DTableRows);
+// Interfaces of registered factories are indexed by pointer, mapping
+// each to its dense index and to the first factory registered for it.
+// Like the object index below, it is an open addressing hash table
+// with linear probing, kept at most half full. Entries are only added,
+// by casycom_register.
+typedef struct _InterfaceEntry {
+    iid_t		iid;
+    const Factory*	factory;
+    const DTableRow*	dtables;	///< Row of factory
+    size_t		index;
+} InterfaceEntry;
+DECLARE_VECTOR_TYPE (InterfaceIndex, InterfaceEntry);
+static _Thread_local VECTOR (InterfaceIndex, _casycom_InterfaceIndex);
+static _Thread_local size_t _casycom_NInterfaces = 0;
+// Interface names are indexed for casycom_interface_by_name, mapping
+// each to the first registered interface with that name. The names are
+// interned as pointers to the interface's own name string, and each
+// entry keeps the hash to skip most string compares. Empty entries
+// have a NULL iid.
+typedef struct _InterfaceNameEntry {
+    iid_t	iid;
+    uint32_t	hash;
+} InterfaceNameEntry;
+DECLARE_VECTOR_TYPE (InterfaceNames, InterfaceNameEntry);
+static _Thread_local VECTOR (InterfaceNames, _casycom_InterfaceNames);
+static _Thread_local size_t _casycom_NInterfaceNames = 0;
 
 // Message link map
 typedef enum _OFlags {
@@ -47,22 +157,133 @@ typedef enum _OFlags {
 typedef struct _MsgLink {
     void*		o;
     const Factory*	factory;
+    const DTableRow*	dtables;	///< Row of factory, NULL for the default object
     Proxy		h;
     uint32_t		flags;
 } MsgLink;
 DECLARE_VECTOR_TYPE (SOMap, MsgLink);
+DECLARE_VECTOR_TYPE (OSlotTable, SOMap*);
+DECLARE_VECTOR_TYPE (OLinkTable, OidVector*);
+
+// _casycom_OSlots contains the message routing table, mapping each
+// proxy-to-object link. It is indexed directly by the destination oid,
+// each slot pointing to the list of incoming links of that object, or
+// NULL if there are none. Each object may have multiple incoming and
+// outgoing links. The first incoming link contains the object pointer
+// (ml->o). The other links have o set to NULL, and are ordered by the
+// order of creation of their proxies. The first link is created by the
+// first proxy created to this object, and is considered to be the
+// creator link. The creator path is used for error handling propagation.
+// Once the creator object is destroyed, all objects created by it are
+// also destroyed.
+static _Thread_local VECTOR (OSlotTable, _casycom_OSlots);
+static _Thread_local size_t _casycom_NLinks = 0;
+// The outgoing links of each object, indexed by the source oid slot.
+// Each list holds the destination oids of the links, newest last, so
+// the destroy cascade finds them without searching the whole table.
+static _Thread_local VECTOR (OLinkTable, _casycom_OutLinks);
+
+// Objects are indexed by pointer, mapping each to its oid for
+// casycom_link_for_object. The index is an open addressing hash table
+// with linear probing, kept at most half full. Empty entries have o NULL.
+typedef struct _ObjectIndexEntry {
+    const void*	o;
+    oid_t	oid;
+} ObjectIndexEntry;
+DECLARE_VECTOR_TYPE (ObjectIndex, ObjectIndexEntry);
+static _Thread_local VECTOR (ObjectIndex, _casycom_ObjectIndex);
+static _Thread_local size_t _casycom_NIndexed = 0;
+
+// Oid slots with links are marked in a bitmap, for casycom_create_proxy
+// to find a free one with word scans. _casycom_OidsFreeWord is the lowest
+// word that may have a free oid. Freed oids can be held in a ring of
+// _casycom_OidReuseDelay entries before being reused, so messages sent
+// to a destroyed object are not misrouted to a new one with its oid.
+DECLARE_VECTOR_TYPE (OidBitmap, uint64_t);
+static _Thread_local VECTOR (OidBitmap, _casycom_OidsUsed);
+static _Thread_local size_t _casycom_OidsFreeWord = 0;
+static unsigned _casycom_OidReuseDelay = 0;
+static _Thread_local VECTOR (OidVector, _casycom_OidsFreed);
+static _Thread_local size_t _casycom_OidsFreedNext = 0;
+#if CASYCOM_WIDE_OIDS
+// Generation of each oid slot, incremented when the slot is freed
+DECLARE_VECTOR_TYPE (OidGenVector, uint16_t);
+static _Thread_local VECTOR (OidGenVector, _casycom_OidGens);
+#endif
+
+// The oid slot table index of \p oid, without its generation
+static inline size_t casycom_oid_index (oid_t oid)
+    { return oid & oid_IndexMask; }
+
+// Objects marked with f_Unused by casycom_mark_unused, to be destroyed
+// in the next idle. An oid may be listed after its object is destroyed
+// by other means, so the f_Unused flag is checked before destroying.
+static _Thread_local VECTOR (OidVector, _casycom_Unused);
+
+// Resolved message destinations are cached, indexed by oid, to skip
+// the link and dtable searches in steady state. Each link table change
+// increments the generation, invalidating all entries.
+typedef struct _DestCacheEntry {
+    uint32_t		gen;
+    MsgLink*		link;	// The object link, valid while gen is current
+    iid_t		iid;
+    const DTable*	dtable;
+    oid_t		oid;
+} DestCacheEntry;
+enum { DEST_CACHE_SIZE = 64 };
+static _Thread_local DestCacheEntry _casycom_DestCache [DEST_CACHE_SIZE];
+static _Thread_local uint32_t _casycom_LinkGen = 1;	// Entries with gen 0 are unused
+
+// The worker pool runs methods of objects whose factories are flagged
+// factory_Serialized or factory_Reentrant. Each worker has its own job
+// queue, filled round-robin by the loops, and idle workers steal jobs
+// from the other queues. Finished jobs are returned to the loop that
+// submitted them, which keeps all link table changes on the loop thread.
+typedef struct _PoolJob {
+    struct _PoolJob*	next;
+    void*		o;
+    const Factory*	factory;
+    Msg*		msgs;	// Messages to dispatch, in order, linked through next
+    LoopShard*		shard;	// Loop to return the finished job to
+    char*		error;	// Set by casycom_error in a method; remaining msgs are not dispatched
+    oid_t		oid;
+    bool		quit;	// casycom_quit was called in a method
+} PoolJob;
 
-// _casycom_OMap contains the message routing table, mapping each
-// proxy-to-object link. The map is sorted by object id. Each object
-// may have multiple incoming and outgoing links. The block of incoming
-// links is contiguous, being sorted, and the first link contains the
-// object pointer (ml->o). The other links have o set to NULL, and are
-// ordered by the order of creation of their proxies. The first
-// link is created by the first proxy created to this object, and is
-// considered to be the creator link. The creator path is used for error
-// handling propagation. Once the creator object is destroyed, all
-// objects created by it are also destroyed.
-static VECTOR (SOMap, _casycom_OMap);
+typedef struct _PoolWorker {
+    pthread_mutex_t	lock;
+    PoolJob*		head;
+    PoolJob*		tail;
+    pthread_t		thread;
+} PoolWorker;
+
+enum { MAX_WORKERS = 64 };
+static PoolWorker _casycom_Workers [MAX_WORKERS];
+static _Atomic(unsigned) _casycom_NWorkers = 0;		// Number of running workers
+static unsigned _casycom_PoolSize = UINT_MAX;		// Number of workers to start, UINT_MAX for one per cpu
+static _Atomic(unsigned) _casycom_PoolQueued = 0;	// Number of jobs in worker queues
+static _Atomic(unsigned) _casycom_PoolIdle = 0;		// Number of workers waiting for jobs
+static _Atomic(unsigned) _casycom_PoolWaiters = 0;	// Number of loops waiting for finished jobs
+static _Atomic(unsigned) _casycom_PoolNext = 0;		// Round-robin index of the worker for the next job
+static bool _casycom_PoolStopping = false;
+static pthread_mutex_t _casycom_PoolLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _casycom_PoolWork = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t _casycom_PoolDone = PTHREAD_COND_INITIALIZER;
+static _Thread_local bool _casycom_InWorker = false;
+// Object whose method is being dispatched on this loop thread
+static _Thread_local oid_t _casycom_Dispatching = oid_Broadcast;
+
+// Each loop tracks its submitted jobs by destination object
+typedef struct _PoolStrand {
+    oid_t	oid;
+    unsigned	running;	// Number of submitted jobs
+    Msg*	pending;	// Messages waiting for the running job to finish
+    Msg*	pendingLast;
+    char*	error;		// Error from the last job, to be handled by the loop
+    bool	closing;	// The object is being destroyed
+} PoolStrand;
+DECLARE_VECTOR_TYPE (PoolStrands, PoolStrand);
+static _Thread_local VECTOR (PoolStrands, _casycom_PoolStrands);
 
 //----------------------------------------------------------------------
 // Local private functions
@@ -70,20 +291,36 @@ static VECTOR (SOMap, _casycom_OMap);
 static MsgLink* casycom_find_destination (oid_t doid);
 static MsgLink* casycom_find_or_create_destination (const Msg* msg);
 static MsgLink* casycom_link_for_object (const void* o);
-static const DTable* casycom_find_dtable (const Factory* o, iid_t iid);
-static const Factory* casycom_find_factory (iid_t iid);
-static size_t casycom_link_for_proxy (const Proxy* ph);
-static size_t casycom_omap_lower_bound (oid_t oid);
+static const DTable* casycom_find_dtable (const Factory* o, const DTableRow* dtables, iid_t iid);
+static const InterfaceEntry* casycom_find_interface (iid_t iid);
+static void casycom_index_interfaces (const Factory* o);
+static MsgLink* casycom_link_for_proxy (const Proxy* ph);
 static void* casycom_create_link_object (MsgLink* ml, const Msg* msg);
-static void casycom_destroy_link_at (size_t l);
+static void casycom_destroy_link (MsgLink* l);
 static void casycom_destroy_object (MsgLink* ol);
-static void casycom_do_message_queues (void);
+static void casycom_do_message_queues (unsigned maxMessages, unsigned maxTimeUs);
 static void casycom_idle (void);
+static void casycom_wake_shard (LoopShard* shard);
+static bool casycom_handle_error (oid_t oid);
+static bool casycom_send_to_shard (const Proxy* pp, uint32_t imethod, const char* text);
+static bool casycom_pool_dispatch (const MsgLink* ml, Msg* msg);
+static void casycom_pool_collect (void);
+static void casycom_pool_quiesce (oid_t oid);
+static void casycom_pool_drain (void);
+static void casycom_pool_stop (void);
+
+// Shard of the calling loop thread; the main shard on other threads
+static inline LoopShard* casycom_loop_shard (void)
+    { return _casycom_Shard ? _casycom_Shard : &_casycom_Shards[0]; }
+static inline LoopShard* casycom_shard_for_oid (oid_t oid)
+    { return &_casycom_Shards[casycom_shard_of (oid)]; }
+static inline bool casycom_is_remote (oid_t oid)
+    { return _casycom_NShards > 1 && casycom_shard_for_oid (oid) != casycom_loop_shard(); }
 
 //}}}-------------------------------------------------------------------
 //{{{ Signal handling
 
-#define S(s) (1<<(s))
+#define S(s) (1u<<(s))	// unsigned, since SIGSYS is bit 31
 enum {
     sigset_Quit	= S(SIGINT)|S(SIGQUIT)|S(SIGTERM)|S(SIGPWR),
     sigset_Die	= S(SIGILL)|S(SIGABRT)|S(SIGBUS)|S(SIGFPE)|S(SIGSYS)|S(SIGSEGV)|S(SIGALRM)|S(SIGXCPU),
@@ -115,134 +352,452 @@ static void casycom_on_msg_signal (int sig)
     #ifdef NDEBUG
 	alarm (1);
     #endif
-    _casycom_LastSignal = sig;
-    if (sig == SIGCHLD)
-	_casycom_LastChildPid = waitpid (-1, &_casycom_LastChildStatus, WNOHANG);
-    else if (S(sig) & sigset_Quit)
+    _casycom_LastSignal = sig;	// Children are reaped by the loop, in casycom_send_signal_message
+    if (S(sig) & sigset_Quit)
 	casycom_quit (qc_ShellSignalQuitOffset+sig);
+    // The signal may arrive on another shard thread than the one with the App
+    casycom_wake_shard (&_casycom_Shards[0]);
 }
 
 static void casycom_install_signal_handlers (void)
 {
+    // Quit signals keep the handler to quit even if the loop is stuck
+    sigset_t sigs;
+    sigemptyset (&sigs);
     for (unsigned sig = 0; sig < sizeof(int)*8; ++sig) {
-	if (sigset_Msg & S(sig))
+	if (sigset_Quit & S(sig))
 	    signal (sig, casycom_on_msg_signal);
+	else if (sigset_Msg & S(sig))
+	    sigaddset (&sigs, sig);
 	else if (sigset_Die & S(sig))
 	    signal (sig, casycom_on_fatal_signal);
     }
+    if (_casycom_SignalFd >= 0)
+	return;
+    pthread_sigmask (SIG_BLOCK, &sigs, &_casycom_SignalMask);
+    if (0 > (_casycom_SignalFd = signalfd (-1, &sigs, SFD_NONBLOCK| SFD_CLOEXEC))) {
+	casycom_log (LOG_ERR, "signalfd: %s\n", strerror(errno));
+	pthread_sigmask (SIG_SETMASK, &_casycom_SignalMask, NULL);
+	for (unsigned sig = 0; sig < sizeof(int)*8; ++sig)
+	    if ((sigset_Msg & ~sigset_Quit) & S(sig))
+		signal (sig, casycom_on_msg_signal);
+    }
+}
+
+// Blocks message signals in the calling thread, saving the old mask in
+// \p oldsigs. Threads created meanwhile inherit it, so pool workers never
+// run the quit handler, which sets the quit flag of the calling thread.
+static void casycom_block_msg_signals (sigset_t* oldsigs)
+{
+    sigset_t sigs;
+    sigemptyset (&sigs);
+    for (unsigned sig = 0; sig < sizeof(int)*8; ++sig)
+	if (sigset_Msg & S(sig))
+	    sigaddset (&sigs, sig);
+    pthread_sigmask (SIG_BLOCK, &sigs, oldsigs);
 }
 #undef S
 
-static inline void casycom_send_signal_message (void)
+/// Restores the signal mask changed by casycom_framework_init. Call it
+/// in forked children before exec, so they do not inherit blocked signals.
+void casycom_restore_signal_mask (void)
 {
-    if (!_casycom_LastSignal)
+    if (_casycom_SignalFd >= 0)
+	pthread_sigmask (SIG_SETMASK, &_casycom_SignalMask, NULL);
+}
+
+// Reaps exited children, sending each unwatched one to the App.
+// Watched children are left for their Child objects.
+static void casycom_send_child_signals (void)
+{
+    int status;
+    for (pid_t pid; 0 < (pid = Child_WaitAny (&status));)
+	PApp_Signal (&_casycom_PApp, SIGCHLD, pid, status);
+}
+
+// These are privately exported to timer.c . Do not use directly.
+// The signalfd is only read by the App loop thread.
+int casycom_signal_fd (void)
+    { return _casycom_PApp.interface ? _casycom_SignalFd : -1; }
+
+// Reads all pending signals, sending each to the App. SIGCHLD is not
+// queued, so one may stand for several children, which are all reaped
+// and reported each in its own message.
+void casycom_read_signals (void)
+{
+    if (casycom_signal_fd() < 0)
 	return;
+    struct signalfd_siginfo si [8];
+    for (ssize_t r; 0 < (r = read (_casycom_SignalFd, si, sizeof(si)));) {
+	for (size_t i = 0; i < r/sizeof(si[0]); ++i) {
+	    const unsigned sig = si[i].ssi_signo;
+	    DEBUG_PRINTF ("[S] Signal %u: %s\n", sig, strsignal(sig));
+	    if (sig == SIGCHLD)
+		casycom_send_child_signals();
+	    else
+		PApp_Signal (&_casycom_PApp, sig, 0, 0);
+	}
+    }
+}
+
+static inline void casycom_send_signal_message (void)
+{
+    if (!_casycom_LastSignal || !_casycom_PApp.interface)
+	return;	// Signals are delivered only by the App shard loop
     alarm (0);	// the alarm was set to check for infinite loops
-    if (_casycom_PApp.interface)
-	PApp_Signal (&_casycom_PApp, _casycom_LastSignal, _casycom_LastChildPid, _casycom_LastChildStatus);
-    _casycom_LastSignal = 0;
+    const unsigned sig = atomic_exchange (&_casycom_LastSignal, 0);
+    if (sig == SIGCHLD)
+	casycom_send_child_signals();
+    else
+	PApp_Signal (&_casycom_PApp, sig, 0, 0);
 }
 
 //}}}-------------------------------------------------------------------
 //{{{ Proxies and link table
 
-/// Creates a proxy to a new object from object \p src, using interface \p iid
-Proxy casycom_create_proxy (iid_t iid, oid_t src)
+// Returns the list of incoming links of object \p oid, or NULL if none.
+// A wide oid of an earlier generation of the slot also gets NULL.
+static inline SOMap* casycom_links_to (oid_t oid)
+{
+    const size_t i = casycom_oid_index (oid);
+    SOMap* links = i < _casycom_OSlots.size ? _casycom_OSlots.d[i] : NULL;
+    return links && links->d[0].h.dest == oid ? links : NULL;
+}
+
+// Returns the oid of slot \p i in its current generation
+static inline oid_t casycom_oid_at (size_t i)
 {
-    // Find first unused oid value
-    // OMap is sorted, so increment nid until a number gap is found
-    oid_t nid = oid_First;
-    if (_casycom_OMap.size)
-	nid = _casycom_OMap.d[0].h.dest;
-    size_t ip = 0;
-    for (; ip < _casycom_OMap.size; ++ip) {
-	if (nid < _casycom_OMap.d[ip].h.dest)
+    #if CASYCOM_WIDE_OIDS
+	if (i < _casycom_OidGens.size)
+	    return i | (oid_t) _casycom_OidGens.d[i] << oid_IndexBits;
+    #endif
+    return i;
+}
+
+static inline bool casycom_oid_is_used (size_t i)
+{
+    const size_t w = i / 64;
+    return w < _casycom_OidsUsed.size && (_casycom_OidsUsed.d[w] & (UINT64_C(1) << (i % 64)));
+}
+
+static void casycom_oid_use (size_t i)
+{
+    const size_t w = i / 64;
+    if (w >= _casycom_OidsUsed.size)
+	vector_resize (&_casycom_OidsUsed, w+1);
+    _casycom_OidsUsed.d[w] |= UINT64_C(1) << (i % 64);
+}
+
+static void casycom_remote_oid_free (size_t i);
+
+static void casycom_oid_free (size_t i)
+{
+    if (!casycom_oid_is_used (i) || _casycom_OSlots.d[i])
+	return;	// Reused through casycom_create_proxy_to while delayed
+    const size_t w = i / 64;
+    _casycom_OidsUsed.d[w] &= ~(UINT64_C(1) << (i % 64));
+    if (_casycom_OidsFreeWord > w)
+	_casycom_OidsFreeWord = w;
+    #if CASYCOM_WIDE_OIDS	// The next object in this slot gets a new oid
+	if (i >= _casycom_OidGens.size)
+	    vector_resize (&_casycom_OidGens, i+1);
+	_casycom_OidGens.d[i] = (_casycom_OidGens.d[i] + 1) & ((1 << oid_GenBits) - 1);
+    #endif
+    casycom_remote_oid_free (i);
+}
+
+// Called when the last link to the object in slot \p i is destroyed
+static void casycom_oid_release (size_t i)
+{
+    if (_casycom_OidsFreed.size != _casycom_OidReuseDelay) {
+	for (size_t j = 0; j < _casycom_OidsFreed.size; ++j)
+	    if (_casycom_OidsFreed.d[j])
+		casycom_oid_free (_casycom_OidsFreed.d[j]);
+	vector_deallocate (&_casycom_OidsFreed);
+	vector_resize (&_casycom_OidsFreed, _casycom_OidReuseDelay);
+	_casycom_OidsFreedNext = 0;
+    }
+    if (!_casycom_OidsFreed.size)
+	return casycom_oid_free (i);
+    // The oldest delayed slot is freed, and this one takes its place
+    oid_t* e = &_casycom_OidsFreed.d[_casycom_OidsFreedNext];
+    if (*e)
+	casycom_oid_free (*e);
+    *e = i;
+    _casycom_OidsFreedNext = (_casycom_OidsFreedNext + 1) % _casycom_OidsFreed.size;
+}
+
+// Returns the first unused oid slot in [first,last), or last if there are none
+static size_t casycom_oid_find_free (size_t first, size_t last)
+{
+    // Words below _casycom_OidsFreeWord are known to be full
+    size_t w = first / 64;
+    if (w < _casycom_OidsFreeWord)
+	w = _casycom_OidsFreeWord;
+    uint64_t used = UINT64_MAX;
+    for (; w * 64 < last; ++w) {
+	used = w < _casycom_OidsUsed.size ? _casycom_OidsUsed.d[w] : 0;
+	if (w == first / 64)
+	    used |= (UINT64_C(1) << (first % 64)) - 1;	// oids below first are not available
+	if (~used)
 	    break;
-	if (nid == _casycom_OMap.d[ip].h.dest)
-	    ++nid;
     }
-    return casycom_create_proxy_to (iid, src, nid);
+    _casycom_OidsFreeWord = w;
+    if (!~used)
+	return last;
+    const size_t oid = w * 64 + __builtin_ctzll (~used);
+    return oid < last ? oid : last;
+}
+
+// Oids of objects created by other shards are taken from the top of the
+// shard's range, and are freed by the shard's loop when the last link to
+// the object there is destroyed. They are then returned to the shard's
+// list, to be reused by the next casycom_create_proxy_in_shard.
+static void casycom_remote_oid_free (size_t i)
+{
+    LoopShard* shard = casycom_loop_shard();
+    const size_t shardEnd = (shard - _casycom_Shards + 1) * _casycom_ShardRange;
+    if (_casycom_NShards < 2 || _casycom_ShardsQuitting || i >= shardEnd || i < shardEnd - shard->nremote)
+	return;	// Not a remote oid of this shard, or no longer needed
+    const oid_t oid = casycom_oid_at (i);
+    acquire_lock (&shard->remotelock);
+    vector_push_back (&shard->remotefree, &oid);
+    release_lock (&shard->remotelock);
+}
+
+/// Creates a proxy to a new object from object \p src, using interface \p iid
+Proxy casycom_create_proxy (iid_t iid, oid_t src)
+{
+    // Find first unused oid value in this shard's oid range, below those allocated by other shards
+    const LoopShard* shard = casycom_loop_shard();
+    const size_t shardFirst = (shard - _casycom_Shards) * _casycom_ShardRange;
+    const size_t shardLast = shardFirst + _casycom_ShardRange - shard->nremote;
+    const size_t nid = casycom_oid_find_free (shardFirst > oid_First ? shardFirst : oid_First, shardLast);
+    assert (nid < shardLast && "ran out of object ids in this shard");
+    return casycom_create_proxy_to (iid, src, casycom_oid_at (nid));
+}
+
+/// Creates a proxy from \p src to a new object in loop shard \p shard.
+/// The object will be created on that shard's thread.
+Proxy casycom_create_proxy_in_shard (iid_t iid, oid_t src, unsigned shard)
+{
+    assert (shard < _casycom_NShards && "invalid shard");
+    LoopShard* dshard = &_casycom_Shards[shard];
+    oid_t nid;
+    acquire_lock (&dshard->remotelock);
+    if (dshard->remotefree.size) {
+	nid = dshard->remotefree.d[dshard->remotefree.size-1];
+	vector_pop_back (&dshard->remotefree);
+    } else
+	nid = shard * _casycom_ShardRange + _casycom_ShardRange-1 - dshard->nremote++;
+    release_lock (&dshard->remotelock);
+    assert (casycom_oid_index (nid) > shard * _casycom_ShardRange && casycom_oid_index (nid) > oid_App && "ran out of object ids in the shard");
+    Proxy pp = casycom_create_proxy_to (iid, src, nid);
+    // Creates the incoming link and the object in the destination shard
+    casymsg_end (casymsg_begin (&pp, method_CreateObject, 0));
+    return pp;
 }
 
 /// Creates a proxy to existing object \p dest from \p src, using interface \p iid
 Proxy casycom_create_proxy_to (iid_t iid, oid_t src, oid_t dest)
 {
-    size_t ip = casycom_omap_lower_bound (dest);
-    while (ip < _casycom_OMap.size && _casycom_OMap.d[ip].h.dest == dest)
-	++ip;
-    MsgLink* e = vector_emplace (&_casycom_OMap, ip);
-    e->factory = casycom_find_factory (iid);
+    assert (!_casycom_InWorker && "objects on the worker pool may only send messages");
+    const size_t i = casycom_oid_index (dest);
+    if (i >= _casycom_OSlots.size)
+	vector_resize (&_casycom_OSlots, i+1);
+    SOMap** slot = &_casycom_OSlots.d[i];
+    if (!*slot) {
+	*slot = xalloc (sizeof(SOMap));
+	VECTOR_MEMBER_INIT (SOMap, **slot);
+	casycom_oid_use (i);
+    }
+    assert ((!(*slot)->size || (*slot)->d[0].h.dest == dest) && "proxy to a destroyed object whose oid slot was reused");
+    MsgLink* e = vector_emplace_back (*slot);
+    const size_t si = casycom_oid_index (src);
+    if (si >= _casycom_OutLinks.size)
+	vector_resize (&_casycom_OutLinks, si+1);
+    OidVector** out = &_casycom_OutLinks.d[si];
+    if (!*out) {
+	*out = xalloc (sizeof(OidVector));
+	VECTOR_MEMBER_INIT (OidVector, **out);
+    }
+    vector_push_back (*out, &dest);
+    ++_casycom_NLinks;
+    ++_casycom_LinkGen;
+    const InterfaceEntry* ie = casycom_find_interface (iid);
+    e->factory = ie ? ie->factory : _casycom_DefaultObject;
+    e->dtables = ie ? ie->dtables : NULL;
     e->h.interface = iid;
     e->h.src = src;
     e->h.dest = dest;
-    DEBUG_PRINTF ("[T] Created proxy link %hu -> %hu.%s\n", e->h.src, e->h.dest, e->h.interface->name);
+    DEBUG_PRINTF ("[T] Created proxy link %u -> %u.%s\n", e->h.src, e->h.dest, e->h.interface->name);
     return e->h;
 }
 
-static void casycom_destroy_link_at (size_t l)
+static void casycom_destroy_link (MsgLink* l)
 {
-    if (l >= _casycom_OMap.size)
+    if (!l)
 	return;
-    MsgLink ol = _casycom_OMap.d[l];	// casycom_destroy_object may destroy other links, so l will be invalidated
-    vector_erase (&_casycom_OMap, l);
-    DEBUG_PRINTF ("[T] Destroyed proxy link %hu -> %hu.%s\n", ol.h.src, ol.h.dest, ol.h.interface->name);
+    MsgLink ol = *l;	// casycom_destroy_object may destroy other links, so l will be invalidated
+    const size_t i = casycom_oid_index (ol.h.dest);
+    SOMap** slot = &_casycom_OSlots.d[i];
+    vector_erase (*slot, vector_p2i (*slot, l));
+    if (!(*slot)->size) {
+	vector_deallocate (*slot);
+	xfree (*slot);
+	casycom_oid_release (i);
+    }
+    OidVector** out = &_casycom_OutLinks.d[casycom_oid_index (ol.h.src)];
+    for (size_t j = (*out)->size; j--;) {
+	if ((*out)->d[j] == ol.h.dest) {
+	    vector_erase (*out, j);
+	    break;
+	}
+    }
+    if (!(*out)->size) {
+	vector_deallocate (*out);
+	xfree (*out);
+    }
+    --_casycom_NLinks;
+    ++_casycom_LinkGen;
+    DEBUG_PRINTF ("[T] Destroyed proxy link %u -> %u.%s\n", ol.h.src, ol.h.dest, ol.h.interface->name);
     if (ol.o)	// If this is the link that created the object, destroy the object
 	casycom_destroy_object (&ol);
+    else if (casycom_is_remote (ol.h.dest))	// The object may be created by its link in its shard
+	casycom_send_to_shard (&ol.h, method_DestroyObject, NULL);
 }
 
 void casycom_destroy_proxy (Proxy* pp)
 {
-    casycom_destroy_link_at (casycom_link_for_proxy (pp));
+    assert (!_casycom_InWorker && "objects on the worker pool may only send messages");
+    casycom_destroy_link (casycom_link_for_proxy (pp));
     pp->interface = NULL;
     pp->src = 0;
     pp->dest = 0;
 }
 
-static size_t casycom_omap_lower_bound (oid_t oid)
+static MsgLink* casycom_link_for_proxy (const Proxy* ph)
 {
-    size_t first = 0, last = _casycom_OMap.size;
-    while (first < last) {
-	size_t mid = (first + last) / 2;
-	if (_casycom_OMap.d[mid].h.dest < oid)
-	    first = mid + 1;
-	else
-	    last = mid;
+    SOMap* links = casycom_links_to (ph->dest);
+    if (links)
+	vector_foreach (MsgLink, l, *links)
+	    if (l->h.src == ph->src)
+		return l;
+    return NULL;
+}
+
+// Hashes pointer \p p for a table of \p tableSize entries, a power of 2
+static inline size_t casycom_pointer_hash (const void* p, size_t tableSize)
+{
+    uint64_t h = (uintptr_t) p * UINT64_C(0x9e3779b97f4a7c15);
+    return (h ^ (h >> 32)) & (tableSize - 1);
+}
+
+static inline size_t casycom_object_hash (const void* o)
+    { return casycom_pointer_hash (o, _casycom_ObjectIndex.size); }
+
+// Returns the index entry of object \p o, or the empty entry where it would go
+static ObjectIndexEntry* casycom_object_index_slot (const void* o)
+{
+    const size_t mask = _casycom_ObjectIndex.size - 1;
+    size_t i = casycom_object_hash (o);
+    while (_casycom_ObjectIndex.d[i].o && _casycom_ObjectIndex.d[i].o != o)
+	i = (i + 1) & mask;
+    return &_casycom_ObjectIndex.d[i];
+}
+
+static void casycom_index_object (const void* o, oid_t oid)
+{
+    if ((_casycom_NIndexed + 1) * 2 > _casycom_ObjectIndex.size) {
+	VECTOR (ObjectIndex, old);
+	vector_swap (&old, &_casycom_ObjectIndex);
+	vector_resize (&_casycom_ObjectIndex, old.size ? old.size * 2 : 16);
+	vector_foreach (const ObjectIndexEntry, e, old)
+	    if (e->o)
+		*casycom_object_index_slot (e->o) = *e;
+	vector_deallocate (&old);
     }
-    return first;
+    ObjectIndexEntry* e = casycom_object_index_slot (o);
+    if (e->o)
+	return;	// Static objects may be shared; the first oid is kept
+    e->o = o;
+    e->oid = oid;
+    ++_casycom_NIndexed;
 }
 
-static size_t casycom_link_for_proxy (const Proxy* ph)
+static void casycom_unindex_object (const void* o, oid_t oid)
 {
-    for (size_t l = casycom_omap_lower_bound (ph->dest);
-		l < _casycom_OMap.size && _casycom_OMap.d[l].h.dest == ph->dest;
-		++l)
-	if (_casycom_OMap.d[l].h.src == ph->src)
-	    return l;
-    return SIZE_MAX;
+    if (!_casycom_ObjectIndex.size)
+	return;
+    ObjectIndexEntry* e = casycom_object_index_slot (o);
+    if (!e->o || e->oid != oid)
+	return;
+    // Shift back the following entries that would not be found past the hole
+    const size_t mask = _casycom_ObjectIndex.size - 1;
+    for (size_t i = vector_p2i (&_casycom_ObjectIndex, e), j = i;;) {
+	_casycom_ObjectIndex.d[i].o = NULL;
+	for (;;) {
+	    j = (j + 1) & mask;
+	    if (!_casycom_ObjectIndex.d[j].o) {
+		--_casycom_NIndexed;
+		return;
+	    }
+	    const size_t k = casycom_object_hash (_casycom_ObjectIndex.d[j].o);
+	    if (i <= j ? (k <= i || j < k) : (k <= i && j < k))
+		break;
+	}
+	_casycom_ObjectIndex.d[i] = _casycom_ObjectIndex.d[j];
+	i = j;
+    }
 }
 
 static MsgLink* casycom_link_for_object (const void* o)
 {
-    for (size_t dp = 0; dp < _casycom_OMap.size; ++dp)
-	if (_casycom_OMap.d[dp].o == o)
-	    return &_casycom_OMap.d[dp];
-    return NULL;
+    if (!_casycom_ObjectIndex.size)
+	return NULL;
+    const ObjectIndexEntry* e = casycom_object_index_slot (o);
+    if (!e->o)
+	return NULL;
+    MsgLink* ml = casycom_find_destination (e->oid);
+    return ml && ml->o == o ? ml : NULL;
 }
 
 static MsgLink* casycom_find_destination (oid_t doid)
 {
-    size_t dp = casycom_omap_lower_bound (doid);
-    if (dp < _casycom_OMap.size && _casycom_OMap.d[dp].h.dest == doid)
-	return &_casycom_OMap.d[dp];
+    SOMap* links = casycom_links_to (doid);
+    return links ? &links->d[0] : NULL;
+}
+
+static inline OidVector* casycom_links_from (oid_t oid)
+{
+    const size_t i = casycom_oid_index (oid);
+    return i < _casycom_OutLinks.size ? _casycom_OutLinks.d[i] : NULL;
+}
+
+// Returns the newest link from object \p oid, or NULL if there are none
+static MsgLink* casycom_find_link_from (oid_t oid)
+{
+    // The list may have links from other generations of the oid slot
+    // in other shards, so each link is checked for the exact source.
+    const OidVector* out = casycom_links_from (oid);
+    for (size_t j = out ? out->size : 0; j--;) {
+	SOMap* links = casycom_links_to (out->d[j]);
+	if (links)
+	    vector_foreach (MsgLink, l, *links)
+		if (l->h.src == oid)
+		    return l;
+    }
     return NULL;
 }
 
 void casycom_debug_dump_link_table (void)
 {
     DEBUG_PRINTF ("[D] Current link table:\n");
-    for (size_t i = 0; i < _casycom_OMap.size; ++i) {
-	const MsgLink* UNUSED l = &_casycom_OMap.d[i];
-	DEBUG_PRINTF ("\t%hu -> %hu.%s\t(%p),%x\n", l->h.src, l->h.dest, l->h.interface->name, l->o, l->flags);
+    for (size_t i = 0; i < _casycom_OSlots.size; ++i) {
+	if (!_casycom_OSlots.d[i])
+	    continue;
+	vector_foreach (const MsgLink, l, *_casycom_OSlots.d[i])
+	    DEBUG_PRINTF ("\t%u -> %u.%s\t(%p),%x\n", l->h.src, l->h.dest, l->h.interface->name, l->o, l->flags);
     }
 }
 
@@ -269,7 +824,7 @@ void casycom_register (const Factory* o)
     #ifndef NDEBUG
 	casycom_debug_check_object (o, "class");
     #endif
-    vector_push_back (&_casycom_ObjectTable, &o);
+    casycom_index_interfaces (o);
 }
 
 /// Registers object class for unknown interfaces
@@ -294,16 +849,19 @@ oid_t casycom_oid_of_object (const void* o)
 /// Marks the given object unused, to be deleted during the next idle
 void casycom_mark_unused (const void* o)
 {
+    assert (!_casycom_InWorker && "objects on the worker pool may only send messages");
     MsgLink* ml = casycom_link_for_object (o);
-    if (ml)
+    if (ml && !(ml->flags & (1<<f_Unused))) {
 	ml->flags |= (1<<f_Unused);
+	vector_push_back (&_casycom_Unused, &ml->h.dest);
+    }
 }
 
 static void* casycom_create_link_object (MsgLink* ml, const Msg* msg)
 {
     assert (!ml->o && "internal error: object already exists");
     // Create using the otable
-    DEBUG_PRINTF ("[T] Creating object %hu.%s\n", ml->h.dest, casymsg_interface_name(msg));
+    DEBUG_PRINTF ("[T] Creating object %u.%s\n", ml->h.dest, casymsg_interface_name(msg));
     void* o = ml->factory->Create (msg);
     assert (o && "object Create method must return a valid object or die");
     return o;
@@ -321,58 +879,73 @@ void* casycom_create_object (const iid_t iid)
 static void casycom_destroy_object (MsgLink* ol)
 {
     // Destroying an object can cause all kinds of ugly recursion as notified
-    // objects destroy proxies and mess up OMap. To work around these problems
+    // objects destroy proxies and mess up the link table. To work around these problems
     // links must be saved and various locks set. ol->o is one of those locks.
     if (!ol->o)
 	return;
-    DEBUG_PRINTF ("[T] Destroying object %hu.%s\n", ol->h.dest, ol->h.interface->name);
+    DEBUG_PRINTF ("[T] Destroying object %u.%s\n", ol->h.dest, ol->h.interface->name);
+    ++_casycom_LinkGen;
+    if (ol->factory->flags & (factory_Serialized| factory_Reentrant))
+	casycom_pool_quiesce (ol->h.dest);	// Wait for its methods running on the workers
     // Call the destructor, if set.
+    const void* o = ol->o;
     if (ol->factory->Destroy) {
 	ol->factory->Destroy (ol->o);
 	ol->o = NULL;
     } else
 	xfree (ol->o);	// Otherwise just free
+    casycom_unindex_object (o, ol->h.dest);
     ol->flags = 0;
     const oid_t oid = ol->h.dest;
     // Notify callers of destruction
-    oid_t callers [16];
-    unsigned nCallers = 0;
-    // In two passes because ObjectDestroyed handlers can modify OMap
-    for (size_t di = 0; di < _casycom_OMap.size; ++di) {
-	const MsgLink* cl = &_casycom_OMap.d[di];
-	if (cl->h.dest == oid && cl->h.src != oid_Broadcast)		// Object calls the destroyed object
-	    callers[nCallers++] = cl->h.src;
-    }
-    for (unsigned i = 0; i < nCallers; ++i) {
-	const MsgLink* cl = casycom_find_destination (callers[i]);	// Find the link with its pointer
+    VECTOR (OidVector, callers);
+    // In two passes because ObjectDestroyed handlers can modify links
+    SOMap* links = casycom_links_to (oid);
+    if (links)
+	vector_foreach (const MsgLink, cl, *links)
+	    if (cl->h.src != oid_Broadcast)				// Object calls the destroyed object
+		vector_push_back (&callers, &cl->h.src);
+    vector_foreach (const oid_t, caller, callers) {
+	if (casycom_is_remote (*caller)) {				// Callers in other shards are notified there
+	    casycom_send_to_shard (&(Proxy){ ol->h.interface, oid, *caller }, method_ObjectDestroyed, NULL);
+	    continue;
+	}
+	const MsgLink* cl = casycom_find_destination (*caller);		// Find the link with its pointer
 	if (cl && cl->factory->ObjectDestroyed) {			// notify of destruction, if requested
-	    DEBUG_PRINTF ("[T]\tNotifying object %hu -> %hu.%s\n", cl->h.src, cl->h.dest, cl->h.interface->name);
+	    DEBUG_PRINTF ("[T]\tNotifying object %u -> %u.%s\n", cl->h.src, cl->h.dest, cl->h.interface->name);
 	    cl->factory->ObjectDestroyed (cl->o, oid);
 	}
     }
-    // Erase all links from this object
-    for (size_t di = 0; di < _casycom_OMap.size; ++di) {
-	if (_casycom_OMap.d[di].h.src == oid) {
-	    casycom_destroy_link_at (di);
-	    di = SIZE_MAX;	// recursion will modify OMap, so have to start over
-	}
-    }
+    vector_deallocate (&callers);
+    // Erase all links from this object; recursion will modify
+    // the link table, so have to look again after each one.
+    for (MsgLink* l; (l = casycom_find_link_from (oid));)
+	casycom_destroy_link (l);
 }
 
 static inline void casycom_destroy_unused_objects (void)
 {
-    for (size_t i = 0; i < _casycom_OMap.size; ++i) {
-	if (_casycom_OMap.d[i].flags & (1<<f_Unused)) {
-	    DEBUG_PRINTF ("[I] Destroying unused object %hu.%s\n", _casycom_OMap.d[i].h.dest, _casycom_OMap.d[i].h.interface->name);
-	    casycom_destroy_object (&_casycom_OMap.d[i]);
-	    i = SIZE_MAX;	// start over because casycom_destroy_object modifies OMap
+    // Destructors may mark more objects unused, appending to the list
+    for (size_t i = 0; i < _casycom_Unused.size; ++i) {
+	MsgLink* ml = casycom_find_destination (_casycom_Unused.d[i]);
+	if (ml && (ml->flags & (1<<f_Unused))) {
+	    DEBUG_PRINTF ("[I] Destroying unused object %u.%s\n", ml->h.dest, ml->h.interface->name);
+	    casycom_destroy_object (ml);
 	}
     }
+    vector_clear (&_casycom_Unused);
 }
 
-static const DTable* casycom_find_dtable (const Factory* o, iid_t iid)
+// Returns the dtable of factory \p o for interface \p iid, from the
+// factory's row of \p dtables. Without a row, the dtable list is
+// searched, as done for the default object and on worker threads.
+static const DTable* casycom_find_dtable (const Factory* o, const DTableRow* dtables, iid_t iid)
 {
-    for (const DTable* const* oi = (const DTable* const*) o->dtable; *oi; ++oi)
+    if (dtables) {
+	const InterfaceEntry* e = casycom_find_interface (iid);
+	if (e && e->index < dtables->size && dtables->d[e->index])
+	    return dtables->d[e->index];
+    } else for (const DTable* const* oi = (const DTable* const*) o->dtable; *oi; ++oi)
 	if ((*oi)->interface == iid)
 	    return *oi;
     if (o == _casycom_DefaultObject)
@@ -380,23 +953,102 @@ static const DTable* casycom_find_dtable (const Factory* o, iid_t iid)
     return NULL;
 }
 
-static const Factory* casycom_find_factory (iid_t iid)
+// Returns the index entry of interface \p iid, or the empty entry where it would go
+static InterfaceEntry* casycom_interface_slot (iid_t iid)
+{
+    const size_t mask = _casycom_InterfaceIndex.size - 1;
+    size_t i = casycom_pointer_hash (iid, _casycom_InterfaceIndex.size);
+    while (_casycom_InterfaceIndex.d[i].iid && _casycom_InterfaceIndex.d[i].iid != iid)
+	i = (i + 1) & mask;
+    return &_casycom_InterfaceIndex.d[i];
+}
+
+// FNV-1a hash of an interface name
+static uint32_t casycom_name_hash (const char* name)
+{
+    uint32_t h = 2166136261u;
+    for (; *name; ++name)
+	h = (h ^ (uint8_t) *name) * 16777619u;
+    return h;
+}
+
+// Returns the name index entry for \p name with \p hash, or the empty entry where it would go
+static InterfaceNameEntry* casycom_interface_name_slot (const char* name, uint32_t hash)
+{
+    const size_t mask = _casycom_InterfaceNames.size - 1;
+    size_t i = hash & mask;
+    for (InterfaceNameEntry* e; (e = &_casycom_InterfaceNames.d[i])->iid; i = (i + 1) & mask)
+	if (e->hash == hash && (e->iid->name == name || !strcmp (e->iid->name, name)))
+	    break;
+    return &_casycom_InterfaceNames.d[i];
+}
+
+static void casycom_index_interface_name (iid_t iid)
 {
-    for (size_t i = 0; i < _casycom_ObjectTable.size; ++i) {
-	const Factory* ot = _casycom_ObjectTable.d[i];
-	if (casycom_find_dtable (ot, iid))
-	    return ot;
+    if ((_casycom_NInterfaceNames + 1) * 2 > _casycom_InterfaceNames.size) {
+	VECTOR (InterfaceNames, old);
+	vector_swap (&old, &_casycom_InterfaceNames);
+	vector_resize (&_casycom_InterfaceNames, old.size ? old.size * 2 : 16);
+	vector_foreach (const InterfaceNameEntry, e, old)
+	    if (e->iid)
+		*casycom_interface_name_slot (e->iid->name, e->hash) = *e;
+	vector_deallocate (&old);
+    }
+    const uint32_t hash = casycom_name_hash (iid->name);
+    InterfaceNameEntry* e = casycom_interface_name_slot (iid->name, hash);
+    if (e->iid)
+	return;	// Another interface has this name; the first one is kept
+    e->iid = iid;
+    e->hash = hash;
+    ++_casycom_NInterfaceNames;
+}
+
+// Indexes the interfaces of factory \p o and builds its dtable row.
+// Interfaces already implemented by an earlier factory keep it.
+static void casycom_index_interfaces (const Factory* o)
+{
+    DTableRow* row = xalloc (sizeof(DTableRow));
+    VECTOR_MEMBER_INIT (DTableRow, *row);
+    vector_push_back (&_casycom_DTableRows, &row);
+    for (const DTable* const* oi = (const DTable* const*) o->dtable; *oi; ++oi) {
+	if ((_casycom_NInterfaces + 1) * 2 > _casycom_InterfaceIndex.size) {
+	    VECTOR (InterfaceIndex, old);
+	    vector_swap (&old, &_casycom_InterfaceIndex);
+	    vector_resize (&_casycom_InterfaceIndex, old.size ? old.size * 2 : 16);
+	    vector_foreach (const InterfaceEntry, e, old)
+		if (e->iid)
+		    *casycom_interface_slot (e->iid) = *e;
+	    vector_deallocate (&old);
+	}
+	InterfaceEntry* e = casycom_interface_slot ((*oi)->interface);
+	if (!e->iid) {
+	    e->iid = (*oi)->interface;
+	    e->factory = o;
+	    e->dtables = row;
+	    e->index = _casycom_NInterfaces++;
+	    casycom_index_interface_name (e->iid);
+	}
+	if (e->index >= row->size)
+	    vector_resize (row, e->index+1);
+	if (!row->d[e->index])		// The first dtable for each interface is used
+	    row->d[e->index] = *oi;
     }
-    return _casycom_DefaultObject;
+}
+
+static const InterfaceEntry* casycom_find_interface (iid_t iid)
+{
+    if (!_casycom_InterfaceIndex.size)
+	return NULL;
+    const InterfaceEntry* e = casycom_interface_slot (iid);
+    return e->iid ? e : NULL;
 }
 
 iid_t casycom_interface_by_name (const char* iname)
 {
-    for (size_t i = 0; i < _casycom_ObjectTable.size; ++i) {
-	const Factory* f = _casycom_ObjectTable.d[i];
-	for (const DTable* const* di = (const DTable* const*) f->dtable; *di; ++di)
-	    if (!strcmp ((*di)->interface->name, iname))
-		return (*di)->interface;
+    if (_casycom_InterfaceNames.size) {
+	const InterfaceNameEntry* e = casycom_interface_name_slot (iname, casycom_name_hash (iname));
+	if (e->iid)
+	    return e->iid;
     }
     if (_casycom_DefaultObject) {
         iid_t defaultInterface = ((const DTable*)_casycom_DefaultObject->dtable[0])->interface;
@@ -413,31 +1065,134 @@ static MsgLink* casycom_find_or_create_destination (const Msg* msg)
     // so if a new object is created, need to find the link again.
     for (void* no = NULL;;) {
 	ml = casycom_find_destination (msg->h.dest);
-	if (!ml || ml->o || (ml->o = no))
+	if (!ml || ml->o)
+	    break;
+	if (no) {
+	    ml->o = no;
+	    casycom_index_object (no, ml->h.dest);
 	    break;
+	}
 	no = casycom_create_link_object (ml, msg);	// Create the object, if needed
     }
     return ml;
 }
 
+// Same as casycom_find_or_create_destination, also returning the dtable
+// for the message interface in \p dtable, using the destination cache.
+static MsgLink* casycom_find_cached_destination (const Msg* msg, const DTable** dtable)
+{
+    DestCacheEntry* e = &_casycom_DestCache [msg->h.dest % DEST_CACHE_SIZE];
+    if (e->gen == _casycom_LinkGen && e->oid == msg->h.dest && e->iid == msg->h.interface) {
+	*dtable = e->dtable;
+	return e->link;
+    }
+    MsgLink* ml = casycom_find_or_create_destination (msg);
+    if (ml) {
+	*dtable = casycom_find_dtable (ml->factory, ml->dtables, msg->h.interface);
+	e->gen = _casycom_LinkGen;
+	e->link = ml;
+	e->iid = msg->h.interface;
+	e->dtable = *dtable;
+	e->oid = msg->h.dest;
+    }
+    return ml;
+}
+
 //}}}-------------------------------------------------------------------
 //{{{ Message queue management
 
+static inline bool casycom_has_quota (const Msg* msg)
+    { return msg->h.interface->quota && msg->imethod < method_ObjectDestroyed; }
+
+// Frees a queued message, removing it from its destination's mailbox count
+static void casycom_free_message (Msg* msg)
+{
+    if (!msg)
+	return;
+    if (casycom_has_quota (msg))
+	atomic_fetch_sub (&_casycom_Mailbox[casycom_oid_index (msg->h.dest)], 1);
+    casymsg_free (msg);
+}
+
+/// Returns the number of messages that can still be sent through \p pp
+/// before the destination's quota for its interface is reached.
+/// Producers can use it for flow control, instead of handling the
+/// "mailbox full" error raised when a message exceeds the quota.
+unsigned casycom_mailbox_room (const Proxy* pp)
+{
+    const uint32_t quota = pp->interface->quota;
+    if (!quota)
+	return UINT_MAX;
+    const uint32_t queued = _casycom_Mailbox[casycom_oid_index (pp->dest)];
+    return queued < quota ? quota - queued : 0;
+}
+
+static inline bool casycom_is_supersedable (const Msg* msg)
+{
+    return msg->imethod < 32 && (msg->h.interface->supersede & (1u << msg->imethod))
+	&& msg->fdoffset == NO_FD_IN_MESSAGE;	// The fd in the replaced one would be leaked
+}
+
+static inline Msg** casycom_superseded_slot (const Msg* msg)
+{
+    size_t h = msg->h.dest ^ (uintptr_t) msg->h.interface / sizeof(void*) ^ msg->imethod * 7;
+    return &_casycom_Superseded [h % SUPERSEDE_TABLE_SIZE];
+}
+
+// Called when \p msg is taken for delivery; it can no longer be superseded
+static inline void casycom_forget_superseded (const Msg* msg)
+{
+    if (casycom_is_supersedable (msg)) {
+	Msg** pm = casycom_superseded_slot (msg);
+	if (*pm == msg)
+	    *pm = NULL;
+    }
+}
+
+// Reports \p msg, dropped for exceeding its quota, to its sender. While
+// the sender's method runs, the error is set and forwarded when it
+// returns, like other errors; a method already failing is not told of
+// more drops. Elsewhere on the loop thread it is forwarded at once.
+// Other threads only get the false return from casymsg_end.
+static void casycom_mailbox_full (const Msg* msg)
+{
+    DEBUG_PRINTF ("[E] Mailbox of %s object %u is full; %u.%s message dropped\n", casymsg_interface_name(msg), msg->h.dest, msg->h.src, casymsg_method_name(msg));
+    const bool inSender = _casycom_InWorker || msg->h.src == _casycom_Dispatching;
+    if (inSender ? _casycom_Error != NULL : !_casycom_Shard)
+	return;
+    char* pending = NULL;	// Of the method running, if any
+    if (!inSender) {
+	pending = _casycom_Error;
+	_casycom_Error = NULL;
+    }
+    casycom_error ("mailbox of %s object %u is full; %s message dropped", casymsg_interface_name(msg), msg->h.dest, casymsg_method_name(msg));
+    if (inSender)
+	return;
+    if (!casycom_forward_error (msg->h.src, msg->h.dest)) {
+	casycom_log (LOG_ERR, "Error: %s\n", _casycom_Error);
+	casycom_quit (EXIT_FAILURE);
+	xfree (_casycom_Error);
+    }
+    _casycom_Error = pending;
+}
+
 // This is privately exported to msg.c . Do not use directly.
 // Places \p msg into the output queue. It is thread-safe.
-void casycom_queue_message (Msg* msg)
+bool casycom_queue_message (Msg* msg)
 {
     #ifndef NDEBUG	// Message validity checks
 	assert (msg->h.interface && (!msg->size || msg->body) && "invalid message");
-	const Factory* destFactory = casycom_find_factory (msg->h.interface);
-	if (!destFactory)
+    // Only the loop thread of the destination shard can check its link table
+    if (casycom_shard_for_oid (msg->h.dest) == _casycom_Shard) {
+	const bool registered = casycom_find_interface (msg->h.interface) || _casycom_DefaultObject;
+	if (!registered)
 	    DEBUG_PRINTF ("Error: you must call casycom_register (&f_%s) to use this interface\n", casymsg_interface_name(msg));
-	assert (destFactory && "message addressed to unregistered interface");
+	assert (registered && "message addressed to unregistered interface");
 	MsgLink* destl = casycom_find_destination (msg->h.dest);
 	assert (destl && "message addressed to an unknown destination");
-	const DTable* dtable = casycom_find_dtable (destl->factory, msg->h.interface);
+	const DTable* dtable = casycom_find_dtable (destl->factory, destl->dtables, msg->h.interface);
 	assert (dtable && "message forwarded to object that does not support its interface");
-	assert (casycom_link_for_proxy(&msg->h) < _casycom_OMap.size && "message sent through a deleted proxy; do not delete proxies in the destructor or in ObjectDeleted!");
+	assert (casycom_link_for_proxy(&msg->h) && "message sent through a deleted proxy; do not delete proxies in the destructor or in ObjectDeleted!");
 	if (msg->imethod != method_CreateObject) {
 	    assert (msg->imethod < casyiface_count_methods (msg->h.interface) && "invalid message destination method");
 	    size_t vmsgsize = casymsg_validate_signature (msg);
@@ -450,41 +1205,357 @@ void casycom_queue_message (Msg* msg)
 	    assert ((msg->fdoffset == NO_FD_IN_MESSAGE || (msg->fdoffset+4u <= msg->size && Align(msg->fdoffset,4) == msg->fdoffset)) && "you must use casymsg_write_fd to write a file descriptor to a message");
 	} else
 	    assert (!msg->size && msg->fdoffset == NO_FD_IN_MESSAGE && "invalid CreateObject message");
+    }
     #endif
-    acquire_lock (&_casycom_OutputQueueLock);
-    vector_push_back (&_casycom_OutputQueue, &msg);
-    release_lock (&_casycom_OutputQueueLock);
+    LoopShard* dshard = casycom_shard_for_oid (msg->h.dest);
+    // Only the destination loop can safely modify its queued messages
+    if (dshard == _casycom_Shard && !_casycom_InWorker && casycom_is_supersedable (msg)) {
+	Msg** pm = casycom_superseded_slot (msg);
+	Msg* om = *pm;
+	if (om && om->h.dest == msg->h.dest && om->h.interface == msg->h.interface && om->imethod == msg->imethod) {
+	    DEBUG_PRINTF ("[T] Message %u -> %u.%s.%s supersedes the queued one\n", msg->h.src, msg->h.dest, casymsg_interface_name(msg), casymsg_method_name(msg));
+	    // The old message keeps its place, and its priority, since it may already be in an input lane
+	    om->h = msg->h;
+	    om->extid = msg->extid;
+	    xfree (om->body);
+	    om->body = msg->body;
+	    om->size = msg->size;
+	    free (msg);	// Its body now belongs to om
+	    return true;
+	}
+	*pm = msg;
+    }
+    // Messages beyond the quota are refused with an error to the sender
+    _Atomic(uint32_t)* mailbox = &_casycom_Mailbox[casycom_oid_index (msg->h.dest)];
+    if (casycom_has_quota (msg) && atomic_fetch_add (mailbox, 1) >= msg->h.interface->quota) {
+	atomic_fetch_sub (mailbox, 1);
+	Msg** pm = casycom_superseded_slot (msg);
+	if (*pm == msg)	// Just added above
+	    *pm = NULL;
+	casycom_mailbox_full (msg);
+	xfree (msg->body);
+	free (msg);
+	return false;
+    }
+    casymsg_queue_push (&dshard->outq, msg);
+    // The loop can only be sleeping if the message came from another thread
+    casycom_wake_shard (dshard);
+    return true;
+}
+
+static void casycom_wake_shard (LoopShard* shard)
+{
+    if (shard->sleeping && atomic_exchange (&shard->sleeping, false)) {
+	static const uint64_t wakeup = 1;
+	if (0 > write (shard->wakefd, &wakeup, sizeof(wakeup)))
+	    DEBUG_PRINTF ("[E] Failed to wake up the loop: %s\n", strerror(errno));
+    }
+}
+
+// These are privately exported to timer.c . Do not use directly.
+// Timer_RunTimer calls casycom_begin_sleep before waiting in poll, and
+// polls casycom_wakeup_fd with the watched fds, if sleeping is allowed.
+// The loop is not allowed to sleep if messages are already queued.
+static LoopShard* casycom_wakeup_shard (void)
+{
+    LoopShard* shard = casycom_loop_shard();
+    if (shard->wakefd < 0 && 0 > (shard->wakefd = eventfd (0, EFD_NONBLOCK| EFD_CLOEXEC)))
+	casycom_log (LOG_ERR, "eventfd: %s\n", strerror(errno));
+    return shard;
+}
+
+bool casycom_begin_sleep (void)
+{
+    LoopShard* shard = casycom_wakeup_shard();
+    shard->sleeping = true;	// Set before checking the queue to not miss a concurrent message
+    if (!casymsg_queue_empty (&shard->outq) || atomic_load (&shard->pooldone) || shard->delaynew || _casycom_ShardsQuitting) {
+	shard->sleeping = false;
+	return false;
+    }
+    return true;
+}
+
+int casycom_wakeup_fd (void)
+    { return casycom_loop_shard()->wakefd; }
+
+void casycom_end_sleep (bool woken)
+{
+    LoopShard* shard = casycom_loop_shard();
+    shard->sleeping = false;
+    uint64_t nWakeups;
+    if (woken && 0 > read (shard->wakefd, &nWakeups, sizeof(nWakeups)))
+	DEBUG_PRINTF ("[E] Failed to read the wakeup counter: %s\n", strerror(errno));
+}
+
+// Sleeps until a message is queued by another thread, or for timeout ms
+static void casycom_wait_for_messages (int timeout)
+{
+    if (!timeout || !casycom_begin_sleep())
+	return;
+    struct pollfd wfd[2] = {
+	{ .fd = casycom_wakeup_fd(), .events = POLLIN },
+	{ .fd = casycom_signal_fd(), .events = POLLIN }
+    };
+    poll (wfd, 1+(wfd[1].fd >= 0), timeout);
+    casycom_end_sleep (wfd[0].revents & POLLIN);
+    if (wfd[1].revents & POLLIN)
+	casycom_read_signals();
+}
+
+static inline MsgLane* casycom_input_lane (const Msg* msg)
+    { return &_casycom_InputQueue[msg->priority < priority_Lanes ? msg->priority : priority_High]; }
+
+// Moves all messages in the output queue to the input queue lanes
+static void casycom_take_output_queue (void)
+{
+    Msg* l = casymsg_queue_take (&casycom_loop_shard()->outq);
+    size_t n [priority_Lanes] = {};
+    for (const Msg* m = l; m; m = m->next)
+	++n[casycom_input_lane(m) - _casycom_InputQueue];
+    // The taken list is newest first, so fill the input lanes from the end
+    size_t iend [priority_Lanes];
+    for (unsigned i = 0; i < priority_Lanes; ++i) {
+	MsgLane* lane = &_casycom_InputQueue[i];
+	iend[i] = lane->q.size + n[i];
+	vector_resize (&lane->q, iend[i]);
+    }
+    for (; l; l = l->next) {
+	MsgLane* lane = casycom_input_lane (l);
+	lane->q.d[--iend[lane - _casycom_InputQueue]] = l;
+    }
+}
+
+// Frees all undelivered input messages
+static void casycom_clear_input_queue (void)
+{
+    memset (_casycom_Superseded, 0, sizeof(_casycom_Superseded));
+    for (unsigned i = 0; i < priority_Lanes; ++i) {
+	MsgLane* lane = &_casycom_InputQueue[i];
+	for (size_t m = 0; m < lane->q.size; ++m)
+	    casycom_free_message (lane->q.d[m]);
+	vector_clear (&lane->q);
+	lane->next = lane->end = lane->unbatched = 0;
+    }
+}
+
+
+static inline bool casycom_have_messages (void)
+{
+    LoopShard* shard = casycom_loop_shard();
+    for (unsigned i = 0; i < priority_Lanes; ++i)
+	if (_casycom_InputQueue[i].q.size)
+	    return true;
+    return !casymsg_queue_empty (&shard->outq) || atomic_load (&shard->pooldone);
+}
+
+// Picks the next input message to deliver this round, or NULL when done.
+// High priority messages sent during the round are picked up immediately,
+// while normal ones wait for the next round, so that a message flood can
+// not keep the loop from its timers. *nHigh counts the high priority run.
+static Msg* casycom_next_input_message (unsigned* nHigh)
+{
+    MsgLane* high = &_casycom_InputQueue[priority_High];
+    MsgLane* normal = &_casycom_InputQueue[priority_Normal];
+    if (!casymsg_queue_empty (&casycom_loop_shard()->outq)) {
+	casycom_take_output_queue();
+	if (normal->end > normal->next)	// New high ones are delivered while this round's normal ones remain
+	    high->end = high->q.size;
+    }
+    MsgLane* lane = normal;
+    if (high->next < high->end && (*nHigh < MAX_HIGH_PRIORITY_RUN || normal->next >= normal->end)) {
+	lane = high;
+	++*nHigh;
+    } else
+	*nHigh = 0;
+    if (lane->next >= lane->end)
+	return NULL;
+    return lane->q.d[lane->next++];
+}
+
+static uint64_t casycom_now_us (void)
+{
+    struct timespec t;
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000 + t.tv_nsec / 1000;
+}
+
+// Returns true if the round may deliver another message after \p n
+static inline bool casycom_within_budget (unsigned n, unsigned maxMessages, uint64_t deadline)
+{
+    if (maxMessages && n >= maxMessages)
+	return false;
+    return !deadline || n % BUDGET_TIME_CHECK_INTERVAL || casycom_now_us() < deadline;
+}
+
+// Returns the number of messages, up to \p maxRun, starting with the one
+// just taken from \p lane, which go to the same method of the same object.
+static size_t casycom_batch_size (const MsgLane* lane, size_t maxRun)
+{
+    const Msg* const* first = (const Msg* const*) &lane->q.d[lane->next-1];
+    size_t n = 1, nmax = lane->end - (lane->next-1);
+    if (nmax > maxRun)
+	nmax = maxRun;
+    while (n < nmax && first[n]->h.dest == first[0]->h.dest
+		    && first[n]->h.interface == first[0]->h.interface
+		    && first[n]->imethod == first[0]->imethod)
+	++n;
+    return n;
+}
+
+// Only the loop thread of a shard may modify its link table, so objects
+// in other shards are destroyed, notified of destroyed objects, and
+// sent errors with internal messages handled by their shard's loop.
+// Returns false if the message could not be sent.
+static bool casycom_send_to_shard (const Proxy* pp, uint32_t imethod, const char* text)
+{
+    if (_casycom_ShardsQuitting)
+	return false;	// The destination shard may already be reset
+    const uint32_t sz = text ? strlen(text)+1 : 0;
+    Msg* msg = casymsg_begin (pp, imethod, sz);
+    if (sz)
+	memcpy (msg->body, text, sz);
+    casymsg_end (msg);
+    return true;
+}
+
+static void casycom_do_shard_message (const Msg* msg)
+{
+    if (msg->imethod == method_DestroyObject) {
+	DEBUG_PRINTF ("[T] Destroying link %u -> %u.%s from shard %u\n", msg->h.src, msg->h.dest, casymsg_interface_name(msg), casycom_shard_of (msg->h.src));
+	casycom_destroy_link (casycom_link_for_proxy (&msg->h));
+    } else if (msg->imethod == method_ObjectDestroyed) {
+	const MsgLink* ml = casycom_find_destination (msg->h.dest);
+	if (ml && ml->o && ml->factory->ObjectDestroyed) {
+	    DEBUG_PRINTF ("[T] Notifying object %u of destroyed %u\n", msg->h.dest, msg->h.src);
+	    ml->factory->ObjectDestroyed (ml->o, msg->h.src);
+	}
+    } else if (msg->imethod == method_ObjectError) {
+	// Continues the creator chain of the failed object in this shard
+	casycom_error ("%s", (const char*) msg->body);
+	casycom_forward_error (msg->h.dest, msg->h.src);
+    }
 }
 
-static void casycom_do_message_queues (void)
+// Delivers the input queue, higher lanes first, until the budget runs out.
+// Undelivered messages remain at the front of their lanes for the next round.
+// Returns the number of messages delivered.
+static unsigned casycom_do_message_pass (unsigned maxMessages, uint64_t deadline)
 {
-    // Deliver all messages in the input queue
-    for (size_t m = 0; m < _casycom_InputQueue.size; ++m) {
-	const Msg* msg = _casycom_InputQueue.d[m];
+    for (unsigned i = 0; i < priority_Lanes; ++i)
+	_casycom_InputQueue[i].end = _casycom_InputQueue[i].q.size;
+    unsigned nHigh = 0, n = 0;
+    for (; casycom_within_budget (n, maxMessages, deadline); ++n) {
+	Msg* msg = casycom_next_input_message (&nHigh);
+	if (!msg)
+	    break;
+	casycom_forget_superseded (msg);
+	MsgLane* lane = casycom_input_lane (msg);
+	Msg** pmsg = &lane->q.d[lane->next-1];
+	*pmsg = NULL;	// Freed below, or owned by the worker pool
+	if (msg->imethod >= method_ObjectDestroyed && msg->imethod <= method_DestroyObject) {
+	    const oid_t dest = _casycom_Dispatching = msg->h.dest;
+	    casycom_do_shard_message (msg);
+	    casycom_free_message (msg);
+	    _casycom_Dispatching = oid_Broadcast;
+	    if (!casycom_handle_error (dest)) {
+		casycom_clear_input_queue();
+		break;
+	    }
+	    continue;
+	}
 	if (DEBUG_MSG_TRACE)
 	    casycom_debug_message_dump (msg);
-	MsgLink* ml = casycom_find_or_create_destination (msg);
-	if (!ml)	// message addressed to object deleted after sending
+	const DTable* dtable = NULL;
+	MsgLink* ml = casycom_find_cached_destination (msg, &dtable);
+	if (!ml && msg->imethod == method_CreateObject && casycom_shard_of (msg->h.src) != casycom_shard()) {
+	    // Objects created by other shards arrive without a link here
+	    casycom_create_proxy_to (msg->h.interface, msg->h.src, msg->h.dest);
+	    ml = casycom_find_cached_destination (msg, &dtable);
+	}
+	if (!ml) {	// message addressed to object deleted after sending
+	    casycom_free_message (msg);
+	    continue;
+	}
+	if (casycom_pool_dispatch (ml, msg))
 	    continue;
-	// Call the interface dispatch with the object and the message
-	const DTable* dtable = casycom_find_dtable (ml->factory, msg->h.interface);
-	((pfn_dispatch) dtable->interface->dispatch) (dtable, ml->o, msg);
+	const oid_t dest = _casycom_Dispatching = msg->h.dest;
+	// Runs of messages to the same method may be delivered in one call.
+	// A declined run is dispatched singly, without offering its rest again.
+	size_t nBatch = 1;
+	if (ml->factory->DispatchBatch && msg->imethod != method_CreateObject && lane->next > lane->unbatched) {
+	    *pmsg = msg;	// The run is passed in place
+	    nBatch = casycom_batch_size (lane, maxMessages ? maxMessages-n : UINT_MAX);
+	    for (size_t i = 1; i < nBatch; ++i) {
+		casycom_forget_superseded (pmsg[i]);
+		if (DEBUG_MSG_TRACE)
+		    casycom_debug_message_dump (pmsg[i]);
+	    }
+	    if (nBatch > 1 && !ml->factory->DispatchBatch (dtable, ml->o, (const Msg* const*) pmsg, nBatch)) {
+		lane->unbatched = lane->next-1 + nBatch;
+		nBatch = 1;
+	    }
+	    *pmsg = NULL;
+	}
+	if (nBatch > 1) {
+	    casycom_free_message (msg);
+	    for (size_t i = 1; i < nBatch; ++i) {
+		casycom_free_message (pmsg[i]);
+		pmsg[i] = NULL;
+	    }
+	    lane->next += nBatch-1;
+	    n += nBatch-1;
+	} else {
+	    // Call the interface dispatch with the object and the message
+	    ((pfn_dispatch) dtable->interface->dispatch) (dtable, ml->o, msg);
+	    casycom_free_message (msg);
+	}
+	_casycom_Dispatching = oid_Broadcast;
 	// After each message, check for generated errors
-	if (_casycom_Error && !casycom_forward_error (msg->h.dest, msg->h.dest)) {
-	    // If nobody can handle the error, print it and quit
-	    casycom_log (LOG_ERR, "Error: %s\n", _casycom_Error);
-	    casycom_quit (EXIT_FAILURE);
+	if (!casycom_handle_error (dest)) {
+	    casycom_clear_input_queue();	// Quitting, so the rest is dropped
 	    break;
 	}
     }
-    // Clear input queue
-    for (size_t m = 0; m < _casycom_InputQueue.size; ++m)
-	casymsg_free (_casycom_InputQueue.d[m]);
-    vector_clear (&_casycom_InputQueue);
+    // Remove delivered messages from the input lanes
+    for (unsigned i = 0; i < priority_Lanes; ++i) {
+	MsgLane* lane = &_casycom_InputQueue[i];
+	if (lane->next)
+	    vector_erase_n (&lane->q, 0, lane->next);
+	lane->next = lane->end = lane->unbatched = 0;
+    }
+    // Handle results of methods run on the worker pool
+    casycom_pool_collect();
     // And make the output queue the input queue for the next round
-    acquire_lock (&_casycom_OutputQueueLock);
-    vector_swap (&_casycom_InputQueue, &_casycom_OutputQueue);
-    release_lock (&_casycom_OutputQueueLock);
+    casycom_take_output_queue();
+    return n;
+}
+
+// Delivers messages in up to _casycom_DrainPasses passes, each pass
+// delivering the messages queued by the one before, so that call chains
+// between local objects complete without going through the idle.
+// The budget applies to all passes together.
+static void casycom_do_message_queues (unsigned maxMessages, unsigned maxTimeUs)
+{
+    const uint64_t deadline = maxTimeUs ? casycom_now_us() + maxTimeUs : 0;
+    unsigned n = 0;
+    for (unsigned pass = 0;;) {
+	n += casycom_do_message_pass (maxMessages ? maxMessages-n : 0, deadline);
+	if (++pass >= _casycom_DrainPasses || _casycom_Quitting || !casycom_have_messages()
+		|| (maxMessages && n >= maxMessages) || (deadline && casycom_now_us() >= deadline))
+	    break;
+    }
+}
+
+// Forwards the error set by a method of object \p oid, if any.
+// Returns false if the error could not be handled.
+static bool casycom_handle_error (oid_t oid)
+{
+    if (!_casycom_Error || casycom_forward_error (oid, oid))
+	return true;
+    // If nobody can handle the error, print it and quit
+    casycom_log (LOG_ERR, "Error: %s\n", _casycom_Error);
+    casycom_quit (EXIT_FAILURE);
+    return false;
 }
 
 void casycom_debug_message_dump (const Msg* msg)
@@ -493,12 +1564,421 @@ void casycom_debug_message_dump (const Msg* msg)
 	printf ("[T] NULL Message\n");
 	return;
     }
-    printf ("[T] Message[%u] %hu -> %hu.%s.%s\n", msg->size, msg->h.src, msg->h.dest, casymsg_interface_name(msg), casymsg_method_name(msg));
+    printf ("[T] Message[%u] %u -> %u.%s.%s\n", msg->size, msg->h.src, msg->h.dest, casymsg_interface_name(msg), casymsg_method_name(msg));
     hexdump (msg->body, msg->size);
 }
 
 //}}}-------------------------------------------------------------------
-//--- Main API
+//{{{ Delayed messages
+
+static void casycom_delayed_sift_up (DelayedQueue* q, size_t i)
+{
+    const DelayedMsg e = q->d[i];
+    for (size_t p; i; i = p) {
+	p = (i-1)/2;
+	if (q->d[p].deadline < e.deadline || (q->d[p].deadline == e.deadline && q->d[p].seq < e.seq))
+	    break;
+	q->d[i] = q->d[p];
+    }
+    q->d[i] = e;
+}
+
+static Msg* casycom_delayed_pop (DelayedQueue* q)
+{
+    Msg* msg = q->d[0].msg;
+    const DelayedMsg e = q->d[q->size-1];
+    vector_pop_back (q);
+    size_t i = 0;
+    for (size_t c; (c = 2*i+1) < q->size; i = c) {
+	if (c+1 < q->size && (q->d[c+1].deadline < q->d[c].deadline || (q->d[c+1].deadline == q->d[c].deadline && q->d[c+1].seq < q->d[c].seq)))
+	    ++c;
+	if (e.deadline < q->d[c].deadline || (e.deadline == q->d[c].deadline && e.seq < q->d[c].seq))
+	    break;
+	q->d[i] = q->d[c];
+    }
+    if (q->size)
+	q->d[i] = e;
+    return msg;
+}
+
+/// Queues \p msg for delivery at \p when, in Timer_NowMS milliseconds.
+/// The message is held by the loop of the sending thread, without a
+/// Timer object. If the sending proxy is destroyed before the deadline,
+/// the message is discarded.
+void casymsg_end_at (Msg* msg, uint64_t when)
+{
+    LoopShard* shard = casycom_loop_shard();
+    acquire_lock (&shard->delaylock);
+    vector_push_back (&shard->delayed, &(DelayedMsg){ when, shard->delayseq++, msg });
+    casycom_delayed_sift_up (&shard->delayed, shard->delayed.size-1);
+    const bool first = shard->delayed.d[0].msg == msg;
+    release_lock (&shard->delaylock);
+    // The loop may be sleeping past the new deadline
+    if (first && shard != _casycom_Shard) {
+	shard->delaynew = true;
+	casycom_wake_shard (shard);
+    }
+}
+
+/// Queues \p msg for delivery after \p ms milliseconds
+void casymsg_end_after (Msg* msg, uint64_t ms)
+    { casymsg_end_at (msg, Timer_NowMS() + ms); }
+
+// Queues delayed messages whose time has come. Returns the deadline of
+// the next one, or TIMER_NONE if there are no more delayed messages.
+static casytimer_t casycom_queue_delayed (void)
+{
+    LoopShard* shard = casycom_loop_shard();
+    shard->delaynew = false;
+    acquire_lock (&shard->delaylock);
+    casytimer_t next = TIMER_NONE;
+    Msg *due = NULL, **pdue = &due;
+    if (shard->delayed.size) {
+	const casytimer_t now = Timer_NowMS();
+	while (shard->delayed.size && shard->delayed.d[0].deadline <= now) {
+	    *pdue = casycom_delayed_pop (&shard->delayed);
+	    pdue = &(*pdue)->next;
+	}
+	if (shard->delayed.size)
+	    next = shard->delayed.d[0].deadline;
+    }
+    *pdue = NULL;
+    release_lock (&shard->delaylock);
+    // Queued without the lock, since a full mailbox calls Error handlers
+    for (Msg* nm; due; due = nm) {
+	nm = due->next;
+	if (casycom_link_for_proxy (&due->h))
+	    casycom_queue_message (due);
+	else {
+	    DEBUG_PRINTF ("[T] Delayed message %u -> %u.%s.%s discarded with its proxy\n", due->h.src, due->h.dest, casymsg_interface_name(due), casymsg_method_name(due));
+	    casymsg_free (due);
+	}
+    }
+    return next;
+}
+
+// Frees all delayed messages of this loop
+static void casycom_clear_delayed (void)
+{
+    LoopShard* shard = casycom_loop_shard();
+    acquire_lock (&shard->delaylock);
+    for (size_t i = 0; i < shard->delayed.size; ++i)
+	casymsg_free (shard->delayed.d[i].msg);
+    vector_deallocate (&shard->delayed);
+    release_lock (&shard->delaylock);
+}
+
+// Returns the poll timeout in ms for deadline \p next, -1 if none
+static int casycom_delay_timeout (casytimer_t next)
+{
+    if (next == TIMER_NONE)
+	return -1;
+    const casytimer_t now = Timer_NowMS();
+    return next <= now ? 0 : next - now < INT_MAX ? (int)(next - now) : INT_MAX;
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ Worker pool
+
+static void casycom_pool_push (PoolWorker* w, PoolJob* j)
+{
+    j->next = NULL;
+    pthread_mutex_lock (&w->lock);
+    if (w->tail)
+	w->tail->next = j;
+    else
+	w->head = j;
+    w->tail = j;
+    pthread_mutex_unlock (&w->lock);
+}
+
+static PoolJob* casycom_pool_pop (PoolWorker* w)
+{
+    pthread_mutex_lock (&w->lock);
+    PoolJob* j = w->head;
+    if (j && !(w->head = j->next))
+	w->tail = NULL;
+    pthread_mutex_unlock (&w->lock);
+    return j;
+}
+
+// Takes a job from the queue of worker \p w, or steals one from the others
+static PoolJob* casycom_pool_take (unsigned w)
+{
+    const unsigned nWorkers = _casycom_NWorkers;
+    for (unsigned i = 0; i < nWorkers; ++i) {
+	PoolJob* j = casycom_pool_pop (&_casycom_Workers[(w+i) % nWorkers]);
+	if (j) {
+	    --_casycom_PoolQueued;
+	    return j;
+	}
+    }
+    return NULL;
+}
+
+static void casycom_pool_run (PoolJob* j)
+{
+    while (j->msgs && !j->error) {
+	Msg* msg = j->msgs;
+	j->msgs = msg->next;
+	// The interface index is per loop thread, so the dtable list is searched here
+	const DTable* dtable = casycom_find_dtable (j->factory, NULL, msg->h.interface);
+	((pfn_dispatch) dtable->interface->dispatch) (dtable, j->o, msg);
+	casycom_free_message (msg);
+	j->error = _casycom_Error;	// The loop will forward it
+	_casycom_Error = NULL;
+    }
+    j->quit = _casycom_Quitting;
+    _casycom_Quitting = false;
+}
+
+static void* casycom_pool_worker (void* arg)
+{
+    const unsigned w = (uintptr_t) arg;
+    _casycom_InWorker = true;
+    for (;;) {
+	PoolJob* j = casycom_pool_take (w);
+	if (!j) {
+	    pthread_mutex_lock (&_casycom_PoolLock);
+	    ++_casycom_PoolIdle;	// Set before checking the queue to not miss a concurrent job
+	    while (!_casycom_PoolQueued && !_casycom_PoolStopping)
+		pthread_cond_wait (&_casycom_PoolWork, &_casycom_PoolLock);
+	    --_casycom_PoolIdle;
+	    const bool stop = !_casycom_PoolQueued;
+	    pthread_mutex_unlock (&_casycom_PoolLock);
+	    if (stop)
+		break;
+	    continue;
+	}
+	casycom_pool_run (j);
+	// Return the finished job to its loop. j may be freed after the push.
+	LoopShard* shard = j->shard;
+	PoolJob* h = atomic_load (&shard->pooldone);
+	do j->next = h; while (!atomic_compare_exchange_weak (&shard->pooldone, &h, j));
+	casycom_wake_shard (shard);
+	if (_casycom_PoolWaiters) {
+	    pthread_mutex_lock (&_casycom_PoolLock);
+	    pthread_cond_broadcast (&_casycom_PoolDone);
+	    pthread_mutex_unlock (&_casycom_PoolLock);
+	}
+    }
+    return NULL;
+}
+
+static void casycom_pool_start (void)
+{
+    pthread_mutex_lock (&_casycom_PoolLock);
+    if (!_casycom_NWorkers) {
+	unsigned n = _casycom_PoolSize;
+	if (n == UINT_MAX) {
+	    long ncpu = sysconf (_SC_NPROCESSORS_ONLN);
+	    n = ncpu > 0 ? ncpu : 1;
+	}
+	if (n > MAX_WORKERS)
+	    n = MAX_WORKERS;
+	DEBUG_PRINTF ("[I] Starting %u pool workers\n", n);
+	for (unsigned i = 0; i < n; ++i) {
+	    pthread_mutex_init (&_casycom_Workers[i].lock, NULL);
+	    _casycom_Workers[i].head = _casycom_Workers[i].tail = NULL;
+	}
+	_casycom_PoolStopping = false;
+	_casycom_NWorkers = n;	// Workers steal from each other, so all queues must be ready first
+	sigset_t oldsigs;
+	casycom_block_msg_signals (&oldsigs);
+	for (unsigned i = 0; i < n; ++i) {
+	    if (0 != pthread_create (&_casycom_Workers[i].thread, NULL, casycom_pool_worker, (void*)(uintptr_t) i)) {
+		casycom_log (LOG_ERR, "failed to start pool worker %u\n", i);
+		exit (EXIT_FAILURE);
+	    }
+	}
+	pthread_sigmask (SIG_SETMASK, &oldsigs, NULL);
+    }
+    pthread_mutex_unlock (&_casycom_PoolLock);
+}
+
+static void casycom_pool_stop (void)
+{
+    if (!_casycom_NWorkers)
+	return;
+    pthread_mutex_lock (&_casycom_PoolLock);
+    _casycom_PoolStopping = true;
+    pthread_cond_broadcast (&_casycom_PoolWork);
+    pthread_mutex_unlock (&_casycom_PoolLock);
+    for (unsigned i = 0; i < _casycom_NWorkers; ++i) {
+	pthread_join (_casycom_Workers[i].thread, NULL);
+	pthread_mutex_destroy (&_casycom_Workers[i].lock);
+    }
+    _casycom_NWorkers = 0;
+}
+
+static PoolStrand* casycom_pool_strand (oid_t oid)
+{
+    for (size_t i = 0; i < _casycom_PoolStrands.size; ++i)
+	if (_casycom_PoolStrands.d[i].oid == oid)
+	    return &_casycom_PoolStrands.d[i];
+    return NULL;
+}
+
+static void casycom_pool_submit (PoolStrand* s, const MsgLink* ml, Msg* msgs)
+{
+    PoolJob* j = xalloc (sizeof(PoolJob));
+    j->o = ml->o;
+    j->factory = ml->factory;
+    j->msgs = msgs;
+    j->shard = casycom_loop_shard();
+    j->oid = s->oid;
+    ++s->running;
+    if (!_casycom_NWorkers)
+	casycom_pool_start();
+    ++_casycom_PoolQueued;	// Counted before the push to keep the count from going negative
+    casycom_pool_push (&_casycom_Workers[_casycom_PoolNext++ % _casycom_NWorkers], j);
+    if (_casycom_PoolIdle) {
+	pthread_mutex_lock (&_casycom_PoolLock);
+	pthread_cond_signal (&_casycom_PoolWork);
+	pthread_mutex_unlock (&_casycom_PoolLock);
+    }
+}
+
+// Gives \p msg to the worker pool if its destination can run there
+static bool casycom_pool_dispatch (const MsgLink* ml, Msg* msg)
+{
+    if (!(ml->factory->flags & (factory_Serialized| factory_Reentrant)) || !_casycom_PoolSize)
+	return false;
+    PoolStrand* s = casycom_pool_strand (ml->h.dest);
+    if (!s) {
+	s = vector_emplace_back (&_casycom_PoolStrands);
+	s->oid = ml->h.dest;
+    }
+    msg->next = NULL;
+    if ((ml->factory->flags & factory_Reentrant) || !(s->running || s->error))
+	casycom_pool_submit (s, ml, msg);
+    else {	// Serialized objects get queued messages when the running job finishes
+	if (s->pendingLast)
+	    s->pendingLast->next = msg;
+	else
+	    s->pending = msg;
+	s->pendingLast = msg;
+    }
+    return true;
+}
+
+static void casycom_pool_erase_strand (PoolStrand* s)
+{
+    for (Msg *msg = s->pending, *nm; msg; msg = nm) {
+	nm = msg->next;
+	casycom_free_message (msg);
+    }
+    xfree (s->error);
+    vector_erase (&_casycom_PoolStrands, vector_p2i (&_casycom_PoolStrands, s));
+}
+
+// Submits pending messages of an idle strand, or erases it if there are none
+static void casycom_pool_resume (PoolStrand* s)
+{
+    if (s->running || s->error || s->closing)
+	return;
+    const MsgLink* ml = casycom_find_destination (s->oid);
+    if (s->pending && ml && ml->o) {
+	Msg* msgs = s->pending;
+	s->pending = s->pendingLast = NULL;
+	casycom_pool_submit (s, ml, msgs);
+    } else
+	casycom_pool_erase_strand (s);
+}
+
+// Takes back jobs finished by the workers
+static void casycom_pool_retire (void)
+{
+    for (PoolJob *j = atomic_exchange (&casycom_loop_shard()->pooldone, NULL), *nj; j; j = nj) {
+	nj = j->next;
+	PoolStrand* s = casycom_pool_strand (j->oid);
+	assert (s && s->running && "internal error: finished job for an unknown strand");
+	--s->running;
+	if (j->msgs) {	// Messages after an error are put back in order
+	    Msg* last = j->msgs;
+	    while (last->next)
+		last = last->next;
+	    if (!(last->next = s->pending))
+		s->pendingLast = last;
+	    s->pending = j->msgs;
+	}
+	if (j->error) {	// The strand is held until the error is handled
+	    if (s->error)
+		xfree (j->error);
+	    else
+		s->error = j->error;
+	}
+	if (j->quit)
+	    casycom_quit (_casycom_ExitCode);
+	xfree (j);
+	casycom_pool_resume (s);
+    }
+}
+
+static void casycom_pool_collect (void)
+{
+    casycom_pool_retire();
+    // Errors are handled here because error handlers may destroy objects
+    for (size_t i = 0; i < _casycom_PoolStrands.size; ++i) {
+	PoolStrand* s = &_casycom_PoolStrands.d[i];
+	if (!s->error)
+	    continue;
+	const oid_t oid = s->oid;
+	xfree (_casycom_Error);
+	_casycom_Error = s->error;
+	s->error = NULL;
+	if (casycom_find_destination (oid))
+	    casycom_handle_error (oid);
+	else
+	    xfree (_casycom_Error);	// The object is already gone
+	if ((s = casycom_pool_strand (oid)))
+	    casycom_pool_resume (s);
+	i = SIZE_MAX;	// start over because error handling modifies strands
+    }
+}
+
+// Waits for any running job of this loop to finish
+static void casycom_pool_wait (void)
+{
+    LoopShard* shard = casycom_loop_shard();
+    ++_casycom_PoolWaiters;
+    pthread_mutex_lock (&_casycom_PoolLock);
+    while (!atomic_load (&shard->pooldone))
+	pthread_cond_wait (&_casycom_PoolDone, &_casycom_PoolLock);
+    pthread_mutex_unlock (&_casycom_PoolLock);
+    --_casycom_PoolWaiters;
+    casycom_pool_retire();
+}
+
+// Waits for running methods of object \p oid and drops its queued messages
+static void casycom_pool_quiesce (oid_t oid)
+{
+    PoolStrand* s = casycom_pool_strand (oid);
+    if (!s)
+	return;
+    DEBUG_PRINTF ("[T] Waiting for pool jobs of object %u\n", oid);
+    s->closing = true;	// Keeps pending messages from being submitted
+    while ((s = casycom_pool_strand (oid))->running)
+	casycom_pool_wait();
+    casycom_pool_erase_strand (s);
+}
+
+// Waits for all jobs of this loop, for reset
+static void casycom_pool_drain (void)
+{
+    while (_casycom_PoolStrands.size)
+	casycom_pool_quiesce (_casycom_PoolStrands.d[0].oid);
+    vector_deallocate (&_casycom_PoolStrands);
+}
+
+/// Sets the number of worker pool threads, started when first needed.
+/// The default is one per cpu. With 0 threads, all objects run on the
+/// loop thread, regardless of factory flags.
+void casycom_set_worker_threads (unsigned n)
+{
+    assert (!_casycom_NWorkers && "the number of workers can not be changed while the pool is running");
+    _casycom_PoolSize = n;
+}
 
 /// Initializes the library and the event loop
 void casycom_init (void)
@@ -511,25 +1991,58 @@ void casycom_init (void)
     else
 	syslogfac = LOG_DAEMON;
     openlog (NULL, syslogopt, syslogfac);
+    _casycom_Shard = &_casycom_Shards[0];
 }
 
 /// Resets the framework to its initial state
 void casycom_reset (void)
 {
     DEBUG_PRINTF ("[I] Resetting casycom\n");
-    while (_casycom_OMap.size)
-	casycom_destroy_link_at (_casycom_OMap.size-1);
-    vector_deallocate (&_casycom_OMap);
-    acquire_lock (&_casycom_OutputQueueLock);
-    for (size_t m = 0; m < _casycom_OutputQueue.size; ++m)
-	casymsg_free (_casycom_OutputQueue.d[m]);
-    vector_deallocate (&_casycom_OutputQueue);
-    release_lock (&_casycom_OutputQueueLock);
-    for (size_t m = 0; m < _casycom_InputQueue.size; ++m)
-	casymsg_free (_casycom_InputQueue.d[m]);
-    vector_deallocate (&_casycom_InputQueue);
-    vector_deallocate (&_casycom_ObjectTable);
+    casycom_pool_drain();
+    // Newest links first; destructors may create links, so wrap around
+    for (size_t i = _casycom_OSlots.size; _casycom_NLinks;) {
+	SOMap* links = i ? _casycom_OSlots.d[i-1] : NULL;
+	if (links)
+	    casycom_destroy_link (&links->d[links->size-1]);
+	else
+	    i = i ? i-1 : _casycom_OSlots.size;
+    }
+    vector_deallocate (&_casycom_OSlots);
+    vector_deallocate (&_casycom_OutLinks);
+    vector_deallocate (&_casycom_ObjectIndex);
+    _casycom_NIndexed = 0;
+    vector_deallocate (&_casycom_OidsUsed);
+    vector_deallocate (&_casycom_OidsFreed);
+    #if CASYCOM_WIDE_OIDS
+	vector_deallocate (&_casycom_OidGens);
+    #endif
+    _casycom_OidsFreeWord = 0;
+    _casycom_OidsFreedNext = 0;
+    vector_deallocate (&_casycom_Unused);
+    ++_casycom_LinkGen;
+    casycom_clear_delayed();
+    casycom_take_output_queue();
+    casycom_clear_input_queue();
+    for (unsigned i = 0; i < priority_Lanes; ++i)
+	vector_deallocate (&_casycom_InputQueue[i].q);
+    Timer_EpollClose();
+    vector_deallocate (&_casycom_InterfaceIndex);
+    _casycom_NInterfaces = 0;
+    vector_deallocate (&_casycom_InterfaceNames);
+    _casycom_NInterfaceNames = 0;
+    for (size_t i = 0; i < _casycom_DTableRows.size; ++i) {
+	vector_deallocate (_casycom_DTableRows.d[i]);
+	xfree (_casycom_DTableRows.d[i]);
+    }
+    vector_deallocate (&_casycom_DTableRows);
+    LoopShard* shard = casycom_loop_shard();
+    if (shard->wakefd >= 0) {
+	close (shard->wakefd);
+	shard->wakefd = -1;
+    }
     xfree (_casycom_Error);
+    if (shard == &_casycom_Shards[0] && _casycom_NShards == 1)
+	casycom_pool_stop();	// Other shards are already stopped
     DEBUG_PRINTF ("[I] Reset complete\n");
 }
 
@@ -549,6 +2062,11 @@ void casycom_quit (int exitCode)
     DEBUG_PRINTF ("[T] Quit requested, exit code %d\n", exitCode);
     _casycom_ExitCode = exitCode;
     _casycom_Quitting = true;
+    if (_casycom_NShards > 1) {	// Sharded loops all quit together
+	_casycom_ShardsQuitting = true;
+	for (unsigned i = 0; i < _casycom_NShards; ++i)
+	    casycom_wake_shard (&_casycom_Shards[i]);
+    }
 }
 
 /// Returns the current exit code
@@ -563,35 +2081,270 @@ bool casycom_is_failed (void)
 int casycom_main (void)
 {
     for (_casycom_Quitting = false; !_casycom_Quitting; casycom_idle())
-	casycom_do_message_queues();
+	casycom_do_message_queues (_casycom_BudgetMessages, _casycom_BudgetTime);
     return _casycom_ExitCode;
 }
 
+// Returns true if the idle loop has something to do
+static bool casycom_have_work (void)
+{
+    return casycom_have_messages() || _casycom_LastSignal
+	|| _casycom_Quitting || _casycom_ShardsQuitting;
+}
+
+// Spins until there is work or the spin window, or \p maxSpin, runs out.
+// Returns true if work arrived within the window.
+static bool casycom_busy_poll (uint64_t start, uint64_t maxSpin)
+{
+    LoopStats* st = &_casycom_Stats;
+    if (!st->spinWindow)
+	return false;
+    if (maxSpin > st->spinWindow)
+	maxSpin = st->spinWindow;
+    // Without timers, fds, shards, or pool jobs nothing can arrive
+    const bool canArrive = _casycom_NShards > 1 || _casycom_PoolStrands.size || maxSpin < st->spinWindow;
+    uint64_t now = start;
+    bool haveWork;
+    while (!(haveWork = casycom_have_work()) && now - start < maxSpin) {
+	if (!Timer_RunTimer (0) && !canArrive)
+	    break;
+	tight_loop_pause();
+	now = casycom_now_us();
+    }
+    st->spinTime += now - start;
+    if (haveWork)
+	++st->nSpinHits;
+    else {
+	++st->nSpinMisses;
+	st->spinWasted += now - start;
+    }
+    return haveWork;
+}
+
+// Updates the average idle gap with the last one, and sets the next
+// spin window to cover most gaps, or to 0 if they are usually longer
+// than the maximum window, when spinning would only waste CPU time.
+static void casycom_adapt_spin_window (uint64_t gap)
+{
+    LoopStats* st = &_casycom_Stats;
+    if (gap > UINT32_MAX)
+	gap = UINT32_MAX;
+    st->idleGap = st->idleGap ? (st->idleGap*UINT64_C(7) + gap) / 8 : gap;
+    uint64_t window = 2*(uint64_t) st->idleGap;
+    if (window < BUSY_POLL_MIN_WINDOW)
+	window = BUSY_POLL_MIN_WINDOW;
+    st->spinWindow = window <= _casycom_BusyPollMax ? window : 0;
+}
+
 static void casycom_idle (void)
 {
     DEBUG_PRINTF ("[I]=======================================================================\n");
     casycom_send_signal_message();	// Check if a signal has fired
     casycom_destroy_unused_objects();	// Destroy objects marked unused
-    // Process timers and fd waits
-    int timerWait = -1;
-    if (_casycom_InputQueue.size + _casycom_OutputQueue.size + _casycom_Quitting)
+    // Process timers and fd waits, waking for the next delayed message
+    const casytimer_t nextDelayed = casycom_queue_delayed();
+    int timerWait = casycom_delay_timeout (nextDelayed);
+    if (casycom_have_messages() || _casycom_Quitting)
 	timerWait = 0;	// Do not wait if there are packets in the queue
-    bool haveTimers = Timer_RunTimer (timerWait);
-    // Quit when there are no more packets or timers
-    if (!haveTimers && !(_casycom_InputQueue.size + _casycom_OutputQueue.size)) {
-	DEBUG_PRINTF ("[E] Ran out of messages. Quitting.\n");
-	casycom_quit (EXIT_SUCCESS);
+    uint64_t idleStart = 0;
+    bool haveTimers = false, spinHit = false;
+    if (timerWait && _casycom_BusyPollMax) {
+	idleStart = casycom_now_us();
+	// The spin polls timers itself; fired ones are only removed in the next idle
+	spinHit = casycom_busy_poll (idleStart, timerWait < 0 ? UINT64_MAX : timerWait*UINT64_C(1000));
+	// Spinning took some of the time to the next delayed message
+	timerWait = casycom_delay_timeout (nextDelayed);
+    }
+    if (!spinHit)
+	haveTimers = Timer_RunTimer (timerWait);
+    if (!spinHit && !haveTimers && !casycom_have_messages()) {
+	// Messages may still come from other shards or from the worker pool
+	if (nextDelayed != TIMER_NONE || _casycom_NShards > 1 || _casycom_PoolStrands.size)
+	    casycom_wait_for_messages (timerWait);
+	else {	// Quit when there are no more packets or timers
+	    DEBUG_PRINTF ("[E] Ran out of messages. Quitting.\n");
+	    casycom_quit (EXIT_SUCCESS);
+	}
+    }
+    if (idleStart)
+	casycom_adapt_spin_window (casycom_now_us() - idleStart);
+    // Sharded loops only quit when told to
+    if (_casycom_ShardsQuitting)
+	_casycom_Quitting = true;
+}
+
+//}}}-------------------------------------------------------------------
+//{{{ Sharded loops
+
+static void casycom_shard_enter (unsigned shard)
+{
+    _casycom_Shard = &_casycom_Shards[shard];
+    if (_casycom_ShardInit)
+	_casycom_ShardInit (shard);
+    // All shards must register their factories before any messages are sent
+    pthread_barrier_wait (&_casycom_ShardsStarted);
+}
+
+static void* casycom_shard_thread (void* arg)
+{
+    casycom_shard_enter ((uintptr_t) arg);
+    casycom_main();
+    casycom_reset();
+    return NULL;
+}
+
+/// Runs the event loop on \p nShards threads, the calling thread being
+/// shard 0. The oid space is split into nShards equal ranges, and each
+/// object lives in the shard whose range contains its oid. Objects
+/// created with casycom_create_proxy are placed in the creating shard.
+/// \p init is called on each shard thread before any loop starts, to
+/// register factories and create the shard's initial objects. All
+/// shards quit when casycom_quit is called on any of them.
+int casycom_main_shards (unsigned nShards, pfn_shard_init init)
+{
+    assert (nShards && nShards <= MAX_SHARDS && "invalid number of shards");
+    assert (_casycom_NShards == 1 && "sharded loops are already running");
+    _casycom_NShards = nShards;
+    _casycom_ShardRange = ((size_t) oid_IndexMask + 1) / nShards;
+    _casycom_ShardsQuitting = false;
+    _casycom_ShardInit = init;
+    pthread_barrier_init (&_casycom_ShardsStarted, NULL, nShards);
+    pthread_t threads [MAX_SHARDS];
+    for (unsigned i = 1; i < nShards; ++i) {
+	_casycom_Shards[i].wakefd = -1;
+	VECTOR_MEMBER_INIT (DelayedQueue, _casycom_Shards[i].delayed);
+	VECTOR_MEMBER_INIT (OidVector, _casycom_Shards[i].remotefree);
+	if (0 != pthread_create (&threads[i], NULL, casycom_shard_thread, (void*)(uintptr_t) i)) {
+	    casycom_log (LOG_ERR, "failed to start shard thread %u\n", i);
+	    exit (EXIT_FAILURE);
+	}
+    }
+    casycom_shard_enter (0);
+    casycom_main();
+    for (unsigned i = 1; i < nShards; ++i)
+	pthread_join (threads[i], NULL);
+    pthread_barrier_destroy (&_casycom_ShardsStarted);
+    for (unsigned i = 0; i < nShards; ++i) {	// Remote oids are freed only while running
+	_casycom_Shards[i].nremote = 0;
+	vector_deallocate (&_casycom_Shards[i].remotefree);
     }
+    _casycom_NShards = 1;
+    _casycom_ShardRange = (size_t) oid_IndexMask + 1;
+    _casycom_ShardsQuitting = false;
+    return _casycom_ExitCode;
+}
+
+/// Returns the shard of the calling loop thread
+unsigned casycom_shard (void)
+    { return casycom_loop_shard() - _casycom_Shards; }
+
+/// Returns the shard which owns object \p oid
+unsigned casycom_shard_of (oid_t oid)
+{
+    unsigned s = casycom_oid_index (oid) / _casycom_ShardRange;
+    return s < _casycom_NShards ? s : _casycom_NShards-1;
 }
 
 /// Do one message loop iteration; for non-framework operation
 /// Returns false when all queues are empty
 bool casycom_loop_once (void)
+    { return casycom_loop_once_budget (_casycom_BudgetMessages, _casycom_BudgetTime); }
+
+/// Same as casycom_loop_once, but delivers at most \p maxMessages
+/// messages, for at most \p maxTimeUs microseconds. 0 is unlimited.
+bool casycom_loop_once_budget (unsigned maxMessages, unsigned maxTimeUs)
 {
+    casycom_queue_delayed();		// Queue delayed messages that are due
     Timer_RunTimer (0);			// Check watched fds
-    casycom_do_message_queues();	// Process any resulting messages
+    casycom_do_message_queues (maxMessages, maxTimeUs);	// Process any resulting messages
     casycom_destroy_unused_objects();	// Destroy objects marked unused
-    return _casycom_InputQueue.size+_casycom_OutputQueue.size;
+    return casycom_have_messages();
+}
+
+/// Limits each loop round to \p maxMessages messages, delivered in at
+/// most \p maxTimeUs microseconds. When the budget runs out, watched fds
+/// and timers are checked before the remaining messages are delivered,
+/// keeping I/O latency bounded under load. 0 is unlimited, the default.
+void casycom_set_dispatch_budget (unsigned maxMessages, unsigned maxTimeUs)
+{
+    _casycom_BudgetMessages = maxMessages;
+    _casycom_BudgetTime = maxTimeUs;
+}
+
+/// Has each loop round keep delivering messages sent during the round,
+/// in up to \p maxPasses passes, before checking timers, fds, and signals.
+/// A request and its reply then take one round instead of two, without
+/// the poll in between. The dispatch budget applies to the whole round.
+/// The default is 1, delivering the new messages in the next round.
+void casycom_set_drain_passes (unsigned maxPasses)
+    { _casycom_DrainPasses = maxPasses ? maxPasses : 1; }
+
+/// Delays reuse of the oids of destroyed objects until \p n more objects
+/// are destroyed in the same shard. Messages still in flight to a destroyed
+/// object, or sent through stale copies of its proxies, are then dropped
+/// instead of being delivered to a new object given the same oid.
+/// The default is 0, reusing the lowest free oid right away.
+void casycom_set_oid_reuse_delay (unsigned n)
+    { _casycom_OidReuseDelay = n; }
+
+/// Enables busy polling in casycom_main. An idle loop will spin on its
+/// queues and watched fds for up to \p maxSpinUs microseconds before
+/// sleeping, trading CPU time for wakeup latency. The spin window adapts
+/// to the observed idle gaps, and spinning stops altogether when they
+/// are mostly longer than \p maxSpinUs. 0, the default, disables it.
+void casycom_set_busy_poll (unsigned maxSpinUs)
+    { _casycom_BusyPollMax = maxSpinUs; }
+
+/// Returns the calling loop thread's statistics
+LoopStats casycom_loop_stats (void)
+    { return _casycom_Stats; }
+
+// Keeps the embedding fd readable while there is work, and has other
+// threads make it readable when they queue messages for this loop.
+static bool casycom_embed_sleep (void)
+{
+    if (!casycom_have_messages() && casycom_begin_sleep())
+	return false;
+    static const uint64_t wakeup = 1;
+    if (0 > write (casycom_wakeup_fd(), &wakeup, sizeof(wakeup)))
+	DEBUG_PRINTF ("[E] Failed to wake up the loop: %s\n", strerror(errno));
+    return true;
+}
+
+/// Returns an fd for embedding the loop of this thread in another event
+/// loop, such as one based on epoll or libuv. The fd becomes readable
+/// when casycom has work to do, and the host loop should then call
+/// casycom_dispatch_ready. It is an epoll fd, to which watched fds are
+/// added as they are watched, so it stays the same for the life of the
+/// loop and the host loop has nothing to rebuild on each iteration.
+int casycom_embed_fd (void)
+{
+    const int efd = Timer_EpollFd (casycom_wakeup_shard()->wakefd);
+    if (efd >= 0) {
+	Timer_EpollArm (casycom_queue_delayed());
+	casycom_embed_sleep();
+    }
+    return efd;
+}
+
+/// Runs one loop iteration for a loop embedded with casycom_embed_fd.
+/// Fires ready fds and expired timers, and delivers at most
+/// \p maxMessages messages, or all of them if 0. Returns true if more
+/// messages are queued, in which case the embedding fd stays readable.
+bool casycom_dispatch_ready (unsigned maxMessages)
+{
+    LoopShard* shard = casycom_loop_shard();
+    casycom_end_sleep (false);
+    uint64_t nWakeups;
+    if (0 > read (shard->wakefd, &nWakeups, sizeof(nWakeups)) && errno != EAGAIN)
+	DEBUG_PRINTF ("[E] Failed to read the wakeup counter: %s\n", strerror(errno));
+    casycom_queue_delayed();
+    Timer_EpollRun();
+    casycom_do_message_queues (maxMessages, 0);
+    casycom_destroy_unused_objects();
+    // Dispatched messages may have set new timers or delayed more messages
+    Timer_EpollArm (casycom_queue_delayed());
+    return casycom_embed_sleep();
 }
 
 /// Create error to be handled at next casycom_forward_error call
@@ -632,13 +2385,20 @@ bool casycom_forward_error (oid_t oid, oid_t eoid)
     MsgLink* ml = casycom_find_destination (oid);
     if (!ml)	// no further links in the chain, set to unhandled
 	return false;
-    DEBUG_PRINTF ("[E] Handling error in object %hu\n", ml->h.dest);
+    DEBUG_PRINTF ("[E] Handling error in object %u\n", ml->h.dest);
     if (ml->o && ml->factory->Error && ml->factory->Error (ml->o, eoid, _casycom_Error)) {
 	DEBUG_PRINTF ("[E] Error handled\n");
 	xfree (_casycom_Error);
 	return true;
     }
     assert (ml->h.src != oid && "an object is never created by itself; use oid_Broadcast as creator for static objects");
+    // Creators in other shards get the error in their shard
+    if (casycom_is_remote (ml->h.src)) {
+	if (!casycom_send_to_shard (&(Proxy){ ml->h.interface, oid, ml->h.src }, method_ObjectError, _casycom_Error))
+	    return false;
+	xfree (_casycom_Error);
+	return true;
+    }
     // If not, fail this object and forward to creator
     return casycom_forward_error (ml->h.src, oid);
 }
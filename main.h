@@ -6,14 +6,36 @@
 #pragma once
 #include "msg.h"
 
+// Factory flags allowing objects to be run on the worker pool.
+// Objects so marked must only send messages from their methods; they
+// may not create or destroy proxies, except in Create and Destroy.
+enum {
+    factory_Serialized = 1,	// Messages are dispatched in order, one at a time, on any worker thread
+    factory_Reentrant = 2	// Messages are dispatched concurrently, in no particular order
+};
+
 typedef struct _Factory {
     void*		(*Create)(const Msg* msg);
     void		(*Destroy)(void* o);
     void		(*ObjectDestroyed)(void* o, oid_t oid);
     bool		(*Error)(void* o, oid_t eoid, const char* msg);
+    // Optional; receives runs of n > 1 queued messages to the same
+    // method of object o. Returns false to have them dispatched singly.
+    bool		(*DispatchBatch)(const void* dtable, void* o, const Msg* const* msgs, size_t n);
+    uint32_t		flags;
     const void* const	dtable[];
 } Factory;
 
+// Loop thread statistics, returned by casycom_loop_stats
+typedef struct _LoopStats {
+    uint64_t	spinTime;	// Microseconds spent busy polling
+    uint64_t	spinWasted;	// Part of spinTime in spins that found nothing
+    uint32_t	nSpinHits;	// Spins ended by arriving work
+    uint32_t	nSpinMisses;	// Spins ended by blocking
+    uint32_t	spinWindow;	// Current spin window, in microseconds
+    uint32_t	idleGap;	// Average idle gap, in microseconds
+} LoopStats;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -27,6 +49,21 @@ bool	casycom_is_quitting (void) noexcept;
 bool	casycom_is_failed (void) noexcept;
 int	casycom_exit_code (void) noexcept;
 bool	casycom_loop_once (void) noexcept;
+bool	casycom_loop_once_budget (unsigned maxMessages, unsigned maxTimeUs) noexcept;
+void	casycom_set_dispatch_budget (unsigned maxMessages, unsigned maxTimeUs) noexcept;
+void	casycom_set_drain_passes (unsigned maxPasses) noexcept;
+void	casycom_set_busy_poll (unsigned maxSpinUs) noexcept;
+void	casycom_set_oid_reuse_delay (unsigned n) noexcept;
+LoopStats casycom_loop_stats (void) noexcept;
+int	casycom_embed_fd (void) noexcept;
+bool	casycom_dispatch_ready (unsigned maxMessages) noexcept;
+
+typedef void (*pfn_shard_init)(unsigned shard);
+
+int	casycom_main_shards (unsigned nShards, pfn_shard_init init) noexcept;
+unsigned casycom_shard (void) noexcept;
+unsigned casycom_shard_of (oid_t oid) noexcept;
+void	casycom_set_worker_threads (unsigned n) noexcept;
 
 typedef void* (pfn_object_init)(const Msg* msg);
 
@@ -36,11 +73,14 @@ void*	casycom_create_object (const iid_t iid) noexcept NONNULL();
 iid_t	casycom_interface_by_name (const char* iname) noexcept NONNULL();
 Proxy	casycom_create_proxy (iid_t iid, oid_t src) noexcept;
 Proxy	casycom_create_proxy_to (iid_t iid, oid_t src, oid_t dest) noexcept;
+Proxy	casycom_create_proxy_in_shard (iid_t iid, oid_t src, unsigned shard) noexcept;
 void	casycom_destroy_proxy (Proxy* pp) noexcept NONNULL();
 void	casycom_error (const char* fmt, ...) noexcept PRINTFARGS(1,2);
 bool	casycom_forward_error (oid_t oid, oid_t eoid) noexcept;
 void	casycom_mark_unused (const void* o) noexcept NONNULL();
+unsigned casycom_mailbox_room (const Proxy* pp) noexcept NONNULL();
 oid_t	casycom_oid_of_object (const void* o) noexcept NONNULL();
+void	casycom_restore_signal_mask (void) noexcept;
 
 #ifndef NDEBUG
     extern bool casycom_DebugMsgTrace;
@@ -53,6 +93,13 @@ oid_t	casycom_oid_of_object (const void* o) noexcept NONNULL();
 void casycom_debug_message_dump (const Msg* msg) noexcept;
 void casycom_debug_dump_link_table (void) noexcept;
 
+// Loop sleep notification for Timer_RunTimer. Do not use directly.
+bool	casycom_begin_sleep (void) noexcept;
+void	casycom_end_sleep (bool woken) noexcept;
+int	casycom_wakeup_fd (void) noexcept;
+int	casycom_signal_fd (void) noexcept;
+void	casycom_read_signals (void) noexcept;
+
 #ifdef __cplusplus
 namespace {
 #endif
@@ -12,6 +12,7 @@ Msg* casymsg_begin (const Proxy* pp, uint32_t imethod, uint32_t sz)
     msg->h = *pp;
     msg->imethod = imethod;
     msg->fdoffset = NO_FD_IN_MESSAGE;
+    msg->priority = pp->interface->priority;
     if ((msg->size = sz))
 	msg->body = xalloc (Align (sz, MESSAGE_BODY_ALIGNMENT));
     return msg;
@@ -39,6 +40,7 @@ void casymsg_forward (const Proxy* pp, Msg* msg)
     fwm->size = msg->size;
     fwm->extid = msg->extid;
     fwm->fdoffset = msg->fdoffset;
+    fwm->priority = msg->priority;
     msg->size = 0;
     msg->body = NULL;
     casymsg_end (fwm);
@@ -8,15 +8,35 @@
 
 //----------------------------------------------------------------------
 
+#if CASYCOM_WIDE_OIDS
+// Wide oids carry the generation of their slot in the high bits. Each
+// reuse of a slot makes a new oid, so stale proxies to a destroyed
+// object do not reach the object that took its place.
+typedef uint32_t	oid_t;
+enum { oid_IndexBits = 20, oid_GenBits = 10 };
+#else
 typedef uint16_t	oid_t;
+enum { oid_IndexBits = 16, oid_GenBits = 0 };
+#endif
+enum { oid_IndexMask = (1 << oid_IndexBits) - 1 };
 
 enum { oid_Broadcast, oid_App, oid_First };
 
 typedef const char*	methodid_t;
 
+// Messages of higher priority are delivered before the others queued
+enum {
+    priority_Normal,
+    priority_High,
+    priority_Lanes
+};
+
 typedef struct _Interface {
     const void*	dispatch;
     methodid_t	name;
+    uint8_t	priority;	///< Default priority of messages to this interface
+    uint32_t	supersede;	///< Bitmask of methods for which a newer message replaces the pending one
+    uint32_t	quota;		///< Maximum undelivered messages to one object; 0 is unlimited
     methodid_t	method[];
 } Interface;
 
@@ -36,14 +56,19 @@ typedef struct _Msg {
     uint32_t	size;
     oid_t	extid;
     uint8_t	fdoffset;
-    uint8_t	reserved;
+    uint8_t	priority;	///< Set from the interface; may be changed before casymsg_end
     void*	body;
+    struct _Msg* next;	///< Link in the message queue
 } Msg;
 
 enum {
     NO_FD_IN_MESSAGE = UINT8_MAX,
     MESSAGE_HEADER_ALIGNMENT = 8,
     MESSAGE_BODY_ALIGNMENT = MESSAGE_HEADER_ALIGNMENT,
+    // Sent between loop shards to objects in the destination shard
+    method_ObjectDestroyed = (uint32_t)-5,
+    method_ObjectError = (uint32_t)-4,
+    method_DestroyObject = (uint32_t)-3,
     method_Invalid = (uint32_t)-2,
     method_CreateObject = (uint32_t)-1
 };
@@ -65,7 +90,9 @@ extern "C" {
 Msg*	casymsg_begin (const Proxy* pp, uint32_t imethod, uint32_t sz) noexcept NONNULL() MALLOCLIKE;
 void	casymsg_from_vector (const Proxy* pp, uint32_t imethod, void* body) noexcept NONNULL();
 void	casymsg_forward (const Proxy* pp, Msg* msg) noexcept NONNULL();
-void	casycom_queue_message (Msg* msg) noexcept NONNULL(); ///< In main.c
+bool	casycom_queue_message (Msg* msg) noexcept NONNULL(); ///< In main.c
+void	casymsg_end_at (Msg* msg, uint64_t when) noexcept NONNULL(); ///< In main.c
+void	casymsg_end_after (Msg* msg, uint64_t ms) noexcept NONNULL(); ///< In main.c
 uint32_t casyiface_count_methods (iid_t iid) noexcept;
 size_t	casymsg_validate_signature (const Msg* msg) noexcept NONNULL();
 
@@ -88,8 +115,9 @@ static inline RStm casymsg_read (const Msg* msg)
     { return (RStm) { msg->body, msg->body + msg->size }; }
 static inline WStm casymsg_write (Msg* msg)
     { return (WStm) { msg->body, msg->body + msg->size }; }
-static inline void casymsg_end (Msg* msg)
-    { casycom_queue_message (msg); }
+/// Queues \p msg. Returns false if it was dropped for exceeding the quota.
+static inline bool casymsg_end (Msg* msg)
+    { return casycom_queue_message (msg); }
 static inline void casymsg_write_fd (Msg* msg, WStm* os, int fd) {
     size_t fdoffset = os->_p - (char*) msg->body;
     assert (fdoffset != NO_FD_IN_MESSAGE && "file descriptors must be passed in the first 252 bytes of the message");
@@ -105,6 +133,29 @@ static inline int casymsg_read_fd (const Msg* msg UNUSED, RStm* is) {
 #define casymsg_free(msg)	\
     do { if (msg) xfree (msg->body); xfree (msg); } while (false)
 
+//----------------------------------------------------------------------
+// Lock-free multi-producer single-consumer message queue.
+// Producers push onto the head of a singly linked list; the consumer
+// takes the entire list in one atomic exchange. The list is returned
+// newest first, so the consumer must reverse it to get arrival order.
+
+typedef _Atomic(Msg*)	MsgQueue;
+
+/// Pushes \p msg onto \p q. Returns true if the queue was empty.
+static inline bool casymsg_queue_push (MsgQueue* q, Msg* msg)
+{
+    Msg* head = atomic_load (q);
+    do {
+	msg->next = head;
+    } while (!atomic_compare_exchange_weak (q, &head, msg));
+    return !head;
+}
+/// Takes all messages from \p q, returning them newest first
+static inline Msg* casymsg_queue_take (MsgQueue* q)
+    { return atomic_exchange (q, NULL); }
+static inline bool casymsg_queue_empty (MsgQueue* q)
+    { return !atomic_load (q); }
+
 static inline void casymsg_default_dispatch (const void* dtable UNUSED, void* o UNUSED, const Msg* msg)
 {
     if (msg->imethod != method_CreateObject)
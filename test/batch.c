@@ -0,0 +1,116 @@
+// This file is part of the casycom project
+//
+// Copyright (c) 2015 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "ping.h"
+
+// An object with many queued messages to the same method can receive
+// the whole run in one call by defining DispatchBatch in its factory.
+// Returning false from it has the run dispatched singly instead, and
+// the rest of a declined run is not offered again.
+//
+enum { c_NPings = 2000 };
+
+typedef struct _Counter {
+    Proxy	reply;
+    unsigned	nOffers;	// DispatchBatch calls
+    unsigned	nOffered;	// Messages passed to DispatchBatch
+    unsigned	nSingle;	// Messages dispatched singly
+    bool	acceptBatch;
+} Counter;
+
+static void* Counter_Create (const Msg* msg)
+{
+    Counter* o = xalloc (sizeof(Counter));
+    o->reply = casycom_create_reply_proxy (&i_PingR, msg);
+    return o;
+}
+
+static void Counter_RunDone (Counter* o)
+{
+    LOG ("%s run: %u offers, %u messages offered, %u dispatched singly\n",
+	    o->acceptBatch ? "Accepted" : "Declined", o->nOffers, o->nOffered, o->nSingle);
+    PPingR_Ping (&o->reply, o->nOffers);
+    o->nOffers = o->nOffered = o->nSingle = 0;
+    o->acceptBatch = !o->acceptBatch;
+}
+
+static void Counter_Ping_Ping (Counter* o, uint32_t u UNUSED)
+{
+    if (++o->nSingle == c_NPings)
+	Counter_RunDone (o);
+}
+
+static bool Counter_DispatchBatch (const void* dtable UNUSED, void* vo, const Msg* const* msgs UNUSED, size_t n)
+{
+    Counter* o = vo;
+    ++o->nOffers;
+    o->nOffered += n;
+    if (!o->acceptBatch)
+	return false;
+    if (o->nOffered == c_NPings)
+	Counter_RunDone (o);
+    return true;
+}
+
+static const DPing d_Counter_Ping = {
+    .interface = &i_Ping,
+    DMETHOD (Counter, Ping_Ping)
+};
+static const Factory f_Counter = {
+    .Create		= Counter_Create,
+    .DispatchBatch	= Counter_DispatchBatch,
+    .dtable		= { &d_Counter_Ping, NULL }
+};
+
+//----------------------------------------------------------------------
+
+typedef struct _App {
+    Proxy	counterp;
+    unsigned	nRuns;
+} App;
+
+static void* App_Create (const Msg* msg UNUSED)
+{
+    static App app = {};
+    if (!app.counterp.interface) {
+	casycom_register (&f_Counter);
+	app.counterp = casycom_create_proxy (&i_Ping, oid_App);
+    }
+    return &app;
+}
+
+static void App_Destroy (void* o UNUSED) {}
+
+static void App_SendRun (App* app)
+{
+    for (uint32_t i = 0; i < c_NPings; ++i)
+	PPing_Ping (&app->counterp, i);
+}
+
+static void App_App_Init (App* app, argc_t argc UNUSED, argv_t argv UNUSED)
+    { App_SendRun (app); }	// The first run is declined
+
+static void App_PingR_Ping (App* app, uint32_t u UNUSED)
+{
+    if (++app->nRuns < 2)
+	App_SendRun (app);	// The second run is accepted
+    else
+	casycom_quit (EXIT_SUCCESS);
+}
+
+static const DApp d_App_App = {
+    .interface = &i_App,
+    DMETHOD (App, App_Init)
+};
+static const DPingR d_App_PingR = {
+    .interface = &i_PingR,
+    DMETHOD (App, PingR_Ping)
+};
+static const Factory f_App = {
+    .Create	= App_Create,
+    .Destroy	= App_Destroy,
+    .dtable	= { &d_App_App, &d_App_PingR, NULL }
+};
+CASYCOM_MAIN (f_App)
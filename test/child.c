@@ -0,0 +1,85 @@
+// This file is part of the casycom project
+//
+// Copyright (c) 2015 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "ping.h"
+#include <sys/wait.h>
+
+// Child processes can be watched by Child objects, each owning a pidfd
+// polled by the timer. The exit is sent to the object that created the
+// Child proxy, instead of as an App Signal. Servers launched through
+// PExtern_LaunchPipeWatched are watched this way. Here three children
+// are forked, each exiting with its own code.
+//
+enum { c_NChildren = 3 };
+
+typedef struct _App {
+    Proxy	child [c_NChildren];
+    pid_t	pid [c_NChildren];
+    int		status [c_NChildren];
+    unsigned	nExited;
+} App;
+
+static void* App_Create (const Msg* msg UNUSED)
+{
+    static App app = {};
+    if (!app.child[0].interface) {
+	// The Child object uses a Timer to poll its pidfd
+	casycom_register (&f_Timer);
+	casycom_register (&f_Child);
+	for (unsigned i = 0; i < c_NChildren; ++i)
+	    app.child[i] = casycom_create_proxy (&i_Child, oid_App);
+    }
+    return &app;
+}
+
+static void App_Destroy (void* o UNUSED) {}
+
+static void App_App_Init (App* app, argc_t argc UNUSED, argv_t argv UNUSED)
+{
+    for (unsigned i = 0; i < c_NChildren; ++i) {
+	pid_t pid = fork();
+	if (pid < 0)
+	    return casycom_error ("fork: %s", strerror(errno));
+	else if (!pid)
+	    _exit (i+1);
+	app->pid[i] = pid;
+	PChild_Watch (&app->child[i], pid);
+    }
+}
+
+// The exits may arrive in any order, so print them when all are in
+static void App_ChildR_Exited (App* app, pid_t pid, int status)
+{
+    for (unsigned i = 0; i < c_NChildren; ++i)
+	if (app->pid[i] == pid)
+	    app->status[i] = status;
+    if (++app->nExited < c_NChildren)
+	return;
+    for (unsigned i = 0; i < c_NChildren; ++i)
+	LOG ("Child %u exited with code %d\n", i, WEXITSTATUS(app->status[i]));
+    casycom_quit (EXIT_SUCCESS);
+}
+
+// Watched children are not reported here
+static void App_App_Signal (App* app UNUSED, unsigned sig, pid_t childPid UNUSED, int childStatus UNUSED)
+{
+    LOG ("Unexpected signal %s\n", strsignal(sig));
+}
+
+static const DApp d_App_App = {
+    .interface = &i_App,
+    DMETHOD (App, App_Init),
+    DMETHOD (App, App_Signal)
+};
+static const DChildR d_App_ChildR = {
+    .interface = &i_ChildR,
+    DMETHOD (App, ChildR_Exited)
+};
+static const Factory f_App = {
+    .Create	= App_Create,
+    .Destroy	= App_Destroy,
+    .dtable	= { &d_App_App, &d_App_ChildR, NULL }
+};
+CASYCOM_MAIN (f_App)
@@ -0,0 +1,66 @@
+// This file is part of the casycom project
+//
+// Copyright (c) 2015 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "ping.h"
+
+// A message can be sent later without a Timer object by ending it with
+// casymsg_end_after, or casymsg_end_at to give a Timer_NowMS deadline.
+// The loop holds such messages until their time comes. Here pings are
+// sent in reverse order, but delayed so that they arrive in order.
+//
+typedef struct _App {
+    Proxy	pingp;
+    unsigned	pingCount;
+} App;
+
+static void* App_Create (const Msg* msg UNUSED)
+{
+    static App app = {};
+    if (!app.pingp.interface) {
+	casycom_register (&f_Ping);
+	app.pingp = casycom_create_proxy (&i_Ping, oid_App);
+    }
+    return &app;
+}
+
+static void App_Destroy (void* o UNUSED) {}
+
+// Delayed messages are created the same way as in PPing_Ping,
+// but ended with casymsg_end_after instead of casymsg_end.
+static void App_PingLater (App* app, uint32_t v, uint64_t ms)
+{
+    Msg* msg = casymsg_begin (&app->pingp, 0, sizeof(v));
+    WStm os = casymsg_write (msg);
+    casystm_write_uint32 (&os, v);
+    casymsg_end_after (msg, ms);
+}
+
+static void App_App_Init (App* app, argc_t argc UNUSED, argv_t argv UNUSED)
+{
+    for (uint32_t i = 3; i; --i)
+	App_PingLater (app, i, i*20);
+}
+
+static void App_PingR_Ping (App* app, uint32_t u)
+{
+    LOG ("Ping %u reply received in app; count %u\n", u, ++app->pingCount);
+    if (app->pingCount == 3)
+	casycom_quit (EXIT_SUCCESS);
+}
+
+static const DApp d_App_App = {
+    .interface = &i_App,
+    DMETHOD (App, App_Init)
+};
+static const DPingR d_App_PingR = {
+    .interface = &i_PingR,
+    DMETHOD (App, PingR_Ping)
+};
+static const Factory f_App = {
+    .Create	= App_Create,
+    .Destroy	= App_Destroy,
+    .dtable	= { &d_App_App, &d_App_PingR, NULL }
+};
+CASYCOM_MAIN (f_App)
@@ -0,0 +1,125 @@
+// This file is part of the casycom project
+//
+// Copyright (c) 2015 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "ping.h"
+
+// By default, messages sent during a loop round are delivered in the
+// next one, after the loop checks timers and fds. With more drain passes,
+// set by casycom_set_drain_passes, a round also delivers the messages
+// sent during it, so a request/reply chain completes in one round.
+// Objects marked unused during the round are destroyed after it, before
+// the poll. Here a pipe readable from the start is only reported then.
+//
+enum {
+    c_NPings = 3,
+    c_DrainPasses = 16
+};
+
+typedef struct _Echo {
+    Proxy	reply;
+} Echo;
+
+static void* Echo_Create (const Msg* msg)
+{
+    LOG ("Echo created\n");
+    Echo* o = xalloc (sizeof(Echo));
+    o->reply = casycom_create_reply_proxy (&i_PingR, msg);
+    return o;
+}
+
+static void Echo_Destroy (void* o)
+{
+    LOG ("Echo destroyed\n");
+    xfree (o);
+}
+
+static void Echo_Ping_Ping (Echo* o, uint32_t v)
+{
+    if (v == c_NPings) {	// Destroyed when the round ends
+	LOG ("Echo marked unused\n");
+	casycom_mark_unused (o);
+    }
+    PPingR_Ping (&o->reply, v);
+}
+
+static const DPing d_Echo_Ping = {
+    .interface = &i_Ping,
+    DMETHOD (Echo, Ping_Ping)
+};
+static const Factory f_Echo = {
+    .Create	= Echo_Create,
+    .Destroy	= Echo_Destroy,
+    .dtable	= { &d_Echo_Ping, NULL }
+};
+
+//----------------------------------------------------------------------
+
+typedef struct _App {
+    Proxy	echop;
+    Proxy	timerp;
+    int		pipefd [2];
+    unsigned	nReplies;
+} App;
+
+static void* App_Create (const Msg* msg UNUSED)
+{
+    static App app = {};
+    if (!app.echop.interface) {
+	casycom_register (&f_Timer);
+	casycom_register (&f_Echo);
+	app.echop = casycom_create_proxy (&i_Ping, oid_App);
+	app.timerp = casycom_create_proxy (&i_Timer, oid_App);
+    }
+    return &app;
+}
+
+static void App_Destroy (void* vo)
+{
+    App* app = vo;
+    for (unsigned i = 0; i < ArraySize(app->pipefd); ++i)
+	close (app->pipefd[i]);
+}
+
+static void App_App_Init (App* app, argc_t argc UNUSED, argv_t argv UNUSED)
+{
+    casycom_set_drain_passes (c_DrainPasses);
+    if (0 > pipe (app->pipefd) || 1 != write (app->pipefd[1], "", 1))
+	return casycom_error ("pipe: %s", strerror(errno));
+    PTimer_WaitRead (&app->timerp, app->pipefd[0]);
+    PPing_Ping (&app->echop, 1);
+}
+
+static void App_PingR_Ping (App* app, uint32_t u)
+{
+    LOG ("Reply %u\n", u);
+    ++app->nReplies;
+    if (u < c_NPings)
+	PPing_Ping (&app->echop, u+1);
+}
+
+static void App_TimerR_Timer (App* app, int fd UNUSED, const Msg* msg UNUSED)
+{
+    LOG ("Pipe polled after %u replies\n", app->nReplies);
+    casycom_quit (EXIT_SUCCESS);
+}
+
+static const DApp d_App_App = {
+    .interface = &i_App,
+    DMETHOD (App, App_Init)
+};
+static const DPingR d_App_PingR = {
+    .interface = &i_PingR,
+    DMETHOD (App, PingR_Ping)
+};
+static const DTimerR d_App_TimerR = {
+    .interface = &i_TimerR,
+    DMETHOD (App, TimerR_Timer)
+};
+static const Factory f_App = {
+    .Create	= App_Create,
+    .Destroy	= App_Destroy,
+    .dtable	= { &d_App_App, &d_App_PingR, &d_App_TimerR, NULL }
+};
+CASYCOM_MAIN (f_App)
@@ -0,0 +1,152 @@
+// This file is part of the casycom project
+//
+// Copyright (c) 2015 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "ping.h"
+#include <sys/wait.h>
+#include <signal.h>
+#include <sys/epoll.h>
+
+//----------------------------------------------------------------------
+// This is the same example as nfwrk, with casycom embedded in a host
+// loop using epoll. Instead of rebuilding a pollfd list on each pass,
+// the host loop watches the one fd returned by casycom_embed_fd, and
+// calls casycom_dispatch_ready when it becomes readable.
+
+typedef struct _PingCaller {
+    Proxy	pingp;
+    unsigned	pingCount;
+    Proxy	externp;
+    pid_t	serverPid;
+} PingCaller;
+
+//----------------------------------------------------------------------
+// Connecting to a server is done as shown in ipcom. In this example,
+// only the PingCaller_ForkAndPipe method is implemented, and both sides
+// use the non-framework operation.
+//
+static void PingCaller_ForkAndPipe (PingCaller* o);
+
+// List of imported/exported interfaces
+static const iid_t eil_Ping[] = { &i_Ping, NULL };
+
+//----------------------------------------------------------------------
+// The PingCaller object will serve as the starting point for the outgoing
+// Ping and as the recipient of the PingR reply. On the server side, it
+// receives the ExternR_Connected message and does nothing else.
+
+static void* PingCaller_Create (const Msg* msg)
+{
+    PingCaller* o = xalloc (sizeof(PingCaller));
+    //
+    // Both sides will need an Extern object. PingCaller oid is the
+    // destination of the (dummy) message creating this object.
+    //
+    o->externp = casycom_create_proxy (&i_Extern, msg->h.dest);
+    //
+    // The constructor initiates what the App did in ipcom: spawn
+    // the server and create an Extern connection. Then, on the client
+    // side, the Ping request is sent.
+    //
+    PingCaller_ForkAndPipe (o);
+    return o;
+}
+
+static void PingCaller_ForkAndPipe (PingCaller* o)
+{
+    // This is the same code as in ipcom
+    int socks[2];
+    if (0 > socketpair (PF_LOCAL, SOCK_STREAM| SOCK_NONBLOCK| SOCK_CLOEXEC, 0, socks))
+	return casycom_error ("socketpair: %s", strerror(errno));
+    int fr = fork();
+    if (fr < 0)
+	return casycom_error ("fork: %s", strerror(errno));
+    if (fr == 0) {	// Server side
+	close (socks[0]);
+	casycom_register (&f_Ping);	// This is the exported interface
+	PExtern_Open (&o->externp, socks[1], EXTERN_SERVER, NULL, eil_Ping);
+    } else {		// Client side
+	o->serverPid = fr;
+	close (socks[1]);
+	PExtern_Open (&o->externp, socks[0], EXTERN_CLIENT, eil_Ping, NULL);
+    }
+}
+
+static void PingCaller_ExternR_Connected (PingCaller* o, const ExternInfo* einfo UNUSED)
+{
+    if (!o->serverPid)
+	return;	// the server side will just listen
+    LOG ("Connected to server.\n");
+    o->pingp = casycom_create_proxy (&i_Ping, o->externp.src);
+    // ... which can then be accessed through the proxy methods.
+    PPing_Ping (&o->pingp, 1);
+}
+
+static void PingCaller_PingR_Ping (PingCaller* o, uint32_t u)
+{
+    LOG ("Ping %u reply received; count %u\n", u, ++o->pingCount);
+    if (o->pingCount < 5)
+	PPing_Ping (&o->pingp, o->pingCount);
+    else
+	casycom_quit (EXIT_SUCCESS);
+}
+
+static const DPingR d_PingCaller_PingR = {
+    .interface = &i_PingR,
+    DMETHOD (PingCaller, PingR_Ping)
+};
+static const DExternR d_PingCaller_ExternR = {
+    .interface = &i_ExternR,
+    DMETHOD (PingCaller, ExternR_Connected)
+};
+static const Factory f_PingCaller = {
+    .Create	= PingCaller_Create,
+    .dtable	= { &d_PingCaller_PingR, &d_PingCaller_ExternR, NULL }
+};
+
+//----------------------------------------------------------------------
+
+static void OnChildSignal (int signo UNUSED) { waitpid (-1, NULL, 0); }
+
+//----------------------------------------------------------------------
+
+int main (void)
+{
+    casycom_init();
+    casycom_enable_externs();
+    signal (SIGCHLD, OnChildSignal);
+    casycom_register (&f_PingCaller);
+    casycom_create_object (&i_PingR);
+    //
+    // The host loop has its own epoll fd, with its own fds in it.
+    // casycom's fd is added to it once, and stays the same.
+    //
+    int hostfd = epoll_create1 (EPOLL_CLOEXEC);
+    struct epoll_event ev = { .events = EPOLLIN, .data.fd = casycom_embed_fd() };
+    epoll_ctl (hostfd, EPOLL_CTL_ADD, ev.data.fd, &ev);
+    //
+    while (!casycom_is_quitting()) {
+	struct epoll_event evs [8];
+	int nEvs = epoll_wait (hostfd, evs, ArraySize(evs), -1);
+	for (int i = 0; i < nEvs; ++i) {
+	    if (evs[i].data.fd != casycom_embed_fd())
+		continue;	// Host fds would be handled here
+	    //
+	    // casycom_dispatch_ready runs one pass of the casycom loop,
+	    // optionally delivering only a given number of messages to
+	    // keep the host loop responsive. The embedding fd stays
+	    // readable while more messages are queued.
+	    //
+	    bool haveMessages = casycom_dispatch_ready (16);
+	    //
+	    // As in nfwrk, the server quits when its connection closes
+	    // and nothing is left to do.
+	    //
+	    if (!haveMessages && !Timer_WatchListSize())
+		casycom_quit (EXIT_SUCCESS);
+	}
+    }
+    close (hostfd);
+    return casycom_exit_code();
+}
@@ -0,0 +1,93 @@
+// This file is part of the casycom project
+//
+// Copyright (c) 2015 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "ping.h"
+
+// Messages have the priority of their interface, which may be changed
+// for each message before casymsg_end. High priority messages overtake
+// the normal ones queued with them, but a run of them can not starve
+// the normal lane: one normal message is let through after every 32.
+//
+enum {
+    c_NNormal = 3,
+    c_NUrgent = 80,
+    c_FirstUrgent = 101
+};
+
+typedef struct _Lanes {
+    unsigned	nNormal;
+    unsigned	nUrgent;
+} Lanes;
+
+static void* Lanes_Create (const Msg* msg UNUSED)
+    { return xalloc (sizeof(Lanes)); }
+
+static void Lanes_Ping_Ping (Lanes* o, uint32_t v)
+{
+    if (v < c_FirstUrgent) {
+	++o->nNormal;
+	LOG ("Normal ping %u after %u urgent\n", v, o->nUrgent);
+    } else if (!o->nUrgent++) {
+	LOG ("Urgent ping %u overtook %u normal\n", v, c_NNormal-o->nNormal);
+    }
+    if (o->nNormal == c_NNormal && o->nUrgent == c_NUrgent)
+	casycom_quit (EXIT_SUCCESS);
+}
+
+static const DPing d_Lanes_Ping = {
+    .interface = &i_Ping,
+    DMETHOD (Lanes, Ping_Ping)
+};
+static const Factory f_Lanes = {
+    .Create	= Lanes_Create,
+    .dtable	= { &d_Lanes_Ping, NULL }
+};
+
+//----------------------------------------------------------------------
+
+typedef struct _App {
+    Proxy	lanesp;
+} App;
+
+static void* App_Create (const Msg* msg UNUSED)
+{
+    static App app = {};
+    if (!app.lanesp.interface) {
+	casycom_register (&f_Lanes);
+	app.lanesp = casycom_create_proxy (&i_Ping, oid_App);
+    }
+    return &app;
+}
+
+static void App_Destroy (void* o UNUSED) {}
+
+// Created the same way as in PPing_Ping, but with the given priority
+static void App_SendPing (App* app, uint32_t v, uint8_t priority)
+{
+    Msg* msg = casymsg_begin (&app->lanesp, 0, sizeof(v));
+    WStm os = casymsg_write (msg);
+    casystm_write_uint32 (&os, v);
+    msg->priority = priority;
+    casymsg_end (msg);
+}
+
+static void App_App_Init (App* app, argc_t argc UNUSED, argv_t argv UNUSED)
+{
+    for (uint32_t i = 1; i <= c_NNormal; ++i)
+	App_SendPing (app, i, priority_Normal);
+    for (uint32_t i = 0; i < c_NUrgent; ++i)
+	App_SendPing (app, c_FirstUrgent+i, priority_High);
+}
+
+static const DApp d_App_App = {
+    .interface = &i_App,
+    DMETHOD (App, App_Init)
+};
+static const Factory f_App = {
+    .Create	= App_Create,
+    .Destroy	= App_Destroy,
+    .dtable	= { &d_App_App, NULL }
+};
+CASYCOM_MAIN (f_App)
@@ -95,7 +95,12 @@ typedef struct _Ping {
 // msg->dest is the new object's oid, which may be saved if needed.
 static void* Ping_Create (const Msg* msg)
 {
-    LOG ("Created Ping %u\n", msg->h.dest);
+    // Oids in other shards depend on the oid width, so print the shard
+    if (casycom_shard()) {
+	LOG ("Created Ping in shard %u\n", casycom_shard());
+    } else {
+	LOG ("Created Ping %u\n", msg->h.dest);
+    }
     Ping* po = xalloc (sizeof(Ping));
     po->reply = casycom_create_reply_proxy (&i_PingR, msg);
     return po;
@@ -11,6 +11,7 @@
 #include "../app.h"
 #include "../timer.h"
 #include "../io.h"
+#include "../child.h"
 #include "../xsrv.h"
 
 //----------------------------------------------------------------------
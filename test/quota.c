@@ -0,0 +1,137 @@
+// This file is part of the casycom project
+//
+// Copyright (c) 2015 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "ping.h"
+
+// An interface may limit the number of undelivered messages queued to
+// one object by setting a quota. Messages beyond it are dropped, and
+// the sender gets a "mailbox full" error. Here the sender overflows
+// the sink's mailbox with delayed messages, which are queued by the
+// loop between dispatches, and the error still goes to the sender.
+//
+typedef void (*MFN_Sink_Put)(void* o, uint32_t v);
+typedef struct _DSink {
+    const Interface*	interface;
+    MFN_Sink_Put	Sink_Put;
+} DSink;
+
+static void Sink_Dispatch (const DSink* dtable, void* o, const Msg* msg)
+{
+    if (msg->imethod == 0) {
+	RStm is = casymsg_read (msg);
+	dtable->Sink_Put (o, casystm_read_uint32 (&is));
+    } else
+	casymsg_default_dispatch (dtable, o, msg);
+}
+
+static const Interface i_Sink = {
+    .name	= "Sink",
+    .dispatch	= Sink_Dispatch,
+    .quota	= 2,
+    .method	= { "Put\0u", NULL }
+};
+
+typedef struct _Sink {
+    unsigned	nPuts;
+} Sink;
+
+static void* Sink_Create (const Msg* msg UNUSED)
+    { return xalloc (sizeof(Sink)); }
+
+static void Sink_Sink_Put (Sink* o, uint32_t v)
+{
+    LOG ("Sink received %u\n", v);
+    if (++o->nPuts == i_Sink.quota)
+	casycom_quit (EXIT_SUCCESS);
+}
+
+static bool Sink_Error (void* o UNUSED, oid_t eoid UNUSED, const char* msg)
+{
+    LOG ("Sink got the error: %s\n", msg);
+    return true;
+}
+
+static const DSink d_Sink_Sink = {
+    .interface = &i_Sink,
+    DMETHOD (Sink, Sink_Put)
+};
+static const Factory f_Sink = {
+    .Create	= Sink_Create,
+    .Error	= Sink_Error,
+    .dtable	= { &d_Sink_Sink, NULL }
+};
+
+//----------------------------------------------------------------------
+
+typedef struct _Sender {
+    Proxy	sinkp;
+} Sender;
+
+static void* Sender_Create (const Msg* msg)
+{
+    Sender* o = xalloc (sizeof(Sender));
+    o->sinkp = casycom_create_proxy (&i_Sink, msg->h.dest);
+    return o;
+}
+
+// Sends n values to the sink, all delayed to the same time
+static void Sender_Ping_Ping (Sender* o, uint32_t n)
+{
+    for (uint32_t i = 1; i <= n; ++i) {
+	Msg* msg = casymsg_begin (&o->sinkp, 0, sizeof(i));
+	WStm os = casymsg_write (msg);
+	casystm_write_uint32 (&os, i);
+	casymsg_end_after (msg, 10);
+    }
+}
+
+static bool Sender_Error (void* o UNUSED, oid_t eoid UNUSED, const char* msg)
+{
+    LOG ("Sender got the error: %s\n", msg);
+    return true;
+}
+
+static const DPing d_Sender_Ping = {
+    .interface = &i_Ping,
+    DMETHOD (Sender, Ping_Ping)
+};
+static const Factory f_Sender = {
+    .Create	= Sender_Create,
+    .Error	= Sender_Error,
+    .dtable	= { &d_Sender_Ping, NULL }
+};
+
+//----------------------------------------------------------------------
+
+typedef struct _App {
+    Proxy	senderp;
+} App;
+
+static void* App_Create (const Msg* msg UNUSED)
+{
+    static App app = {};
+    if (!app.senderp.interface) {
+	casycom_register (&f_Sender);
+	casycom_register (&f_Sink);
+	app.senderp = casycom_create_proxy (&i_Ping, oid_App);
+    }
+    return &app;
+}
+
+static void App_Destroy (void* o UNUSED) {}
+
+static void App_App_Init (App* app, argc_t argc UNUSED, argv_t argv UNUSED)
+    { PPing_Ping (&app->senderp, i_Sink.quota+1); }
+
+static const DApp d_App_App = {
+    .interface = &i_App,
+    DMETHOD (App, App_Init)
+};
+static const Factory f_App = {
+    .Create	= App_Create,
+    .Destroy	= App_Destroy,
+    .dtable	= { &d_App_App, NULL }
+};
+CASYCOM_MAIN (f_App)
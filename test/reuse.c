@@ -0,0 +1,63 @@
+// This file is part of the casycom project
+//
+// Copyright (c) 2015 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "ping.h"
+
+// casycom_create_proxy gives a new object the lowest free oid. Freed
+// oids are normally reused at once, so a message sent late to a
+// destroyed object could reach a new one with its oid. Setting a reuse
+// delay with casycom_set_oid_reuse_delay has each freed oid wait until
+// that many more oids are freed. Here proxies are created and destroyed
+// one at a time, without and with a delay of 3.
+//
+enum {
+    c_NProxies = 6,
+    c_ReuseDelay = 3
+};
+
+// Prints the oids of proxies created and destroyed one at a time,
+// relative to the first, since the oid of the first depends on the
+// oid width. The slot index is printed, without the generation.
+static void CreateAndDestroyProxies (unsigned reuseDelay)
+{
+    casycom_set_oid_reuse_delay (reuseDelay);
+    LOG ("With reuse delay %u, oids are", reuseDelay);
+    oid_t first = 0;
+    for (unsigned i = 0; i < c_NProxies; ++i) {
+	Proxy pp = casycom_create_proxy (&i_Ping, oid_App);
+	const oid_t oid = pp.dest & oid_IndexMask;
+	if (!i)
+	    first = oid;
+	LOG (" first+%u", oid - first);
+	casycom_destroy_proxy (&pp);
+    }
+    LOG ("\n");
+}
+
+static void* App_Create (const Msg* msg UNUSED)
+{
+    static bool app = false;
+    return &app;
+}
+
+static void App_Destroy (void* o UNUSED) {}
+
+static void App_App_Init (void* app UNUSED, argc_t argc UNUSED, argv_t argv UNUSED)
+{
+    CreateAndDestroyProxies (0);
+    CreateAndDestroyProxies (c_ReuseDelay);
+    casycom_quit (EXIT_SUCCESS);
+}
+
+static const DApp d_App_App = {
+    .interface = &i_App,
+    DMETHOD (App, App_Init)
+};
+static const Factory f_App = {
+    .Create	= App_Create,
+    .Destroy	= App_Destroy,
+    .dtable	= { &d_App_App, NULL }
+};
+CASYCOM_MAIN (f_App)
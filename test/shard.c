@@ -0,0 +1,84 @@
+// This file is part of the casycom project
+//
+// Copyright (c) 2015 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "ping.h"
+
+// The event loop can be run on several threads, each thread running
+// a shard of the object space. Each object belongs to the shard whose
+// oid range contains its oid, and all its messages are dispatched on
+// that shard's thread, so objects never need locking. Messages between
+// objects in different shards are queued directly to the destination
+// shard. This example runs the app in shard 0 and a Ping object in
+// shard 1, with the same Ping object as in the fwork example.
+//
+typedef struct _App {
+    Proxy	pingp;
+    unsigned	pingCount;
+} App;
+
+static void* App_Create (const Msg* msg UNUSED)
+{
+    static App app = {};
+    if (!app.pingp.interface) {
+	// casycom_create_proxy would create the object in this shard,
+	// so use casycom_create_proxy_in_shard to place it elsewhere.
+	app.pingp = casycom_create_proxy_in_shard (&i_Ping, oid_App, 1);
+    }
+    return &app;
+}
+
+static void App_Destroy (void* o UNUSED) {}
+
+static void App_App_Init (App* app, argc_t argc UNUSED, argv_t argv UNUSED)
+{
+    PPing_Ping (&app->pingp, 1);
+}
+
+static void App_PingR_Ping (App* app, uint32_t u)
+{
+    LOG ("Ping %u reply received in app shard %u; count %u\n", u, casycom_shard(), ++app->pingCount);
+    if (app->pingCount < 3)
+	PPing_Ping (&app->pingp, u+1);
+    else if (app->pingCount == 3) {
+	// Destroying the proxy destroys the object in its own shard.
+	// Messages from one shard to another arrive in order, so the
+	// reply from the new object will come after the Destroy.
+	casycom_destroy_proxy (&app->pingp);
+	app->pingp = casycom_create_proxy_in_shard (&i_Ping, oid_App, 1);
+	PPing_Ping (&app->pingp, u+1);
+    } else	// Quitting in any shard quits all shards
+	casycom_quit (EXIT_SUCCESS);
+}
+
+static const DApp d_App_App = {
+    .interface = &i_App,
+    DMETHOD (App, App_Init)
+};
+static const DPingR d_App_PingR = {
+    .interface = &i_PingR,
+    DMETHOD (App, PingR_Ping)
+};
+static const Factory f_App = {
+    .Create	= App_Create,
+    .Destroy	= App_Destroy,
+    .dtable	= { &d_App_App, &d_App_PingR, NULL }
+};
+
+// The shard init function is called on each shard thread before any
+// loop starts. Objects receiving messages in a shard must have their
+// factories registered in that shard.
+static void InitShard (unsigned shard)
+{
+    if (shard == 1)
+	casycom_register (&f_Ping);
+}
+
+// casycom_main_shards replaces casycom_main, running the loop on
+// the given number of threads, of which the calling thread is shard 0.
+int main (int argc, argv_t argv)
+{
+    casycom_framework_init (&f_App, argc, argv);
+    return casycom_main_shards (2, InitShard);
+}
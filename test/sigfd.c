@@ -0,0 +1,103 @@
+// This file is part of the casycom project
+//
+// Copyright (c) 2015 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "ping.h"
+#include <sys/wait.h>
+
+// Signals are read from a signalfd polled with the watched fds, and
+// sent to the App's Signal method, like SIGUSR1 here. SIGCHLD signals
+// may be merged, so all exited children are reaped together, each sent
+// in its own Signal message. Quit signals, like SIGTERM, keep a handler
+// instead, to quit even if the loop is stuck, with the exit code the
+// shell would give a process killed by them.
+//
+enum {
+    c_NChildren = 3,
+    c_TimeoutMs = 5000
+};
+
+typedef struct _App {
+    Proxy	timerp;
+    int		status [c_NChildren];
+    pid_t	pid [c_NChildren];
+    unsigned	nExited;
+} App;
+
+static void* App_Create (const Msg* msg UNUSED)
+{
+    static App app = {};
+    if (!app.timerp.interface) {
+	casycom_register (&f_Timer);
+	app.timerp = casycom_create_proxy (&i_Timer, oid_App);
+    }
+    return &app;
+}
+
+static void App_Destroy (void* o UNUSED) {}
+
+static void App_App_Init (App* app, argc_t argc UNUSED, argv_t argv UNUSED)
+{
+    // The loop quits when it has nothing to wait for
+    PTimer_Timer (&app->timerp, Timer_NowMS() + c_TimeoutMs);
+    for (unsigned i = 0; i < c_NChildren; ++i) {
+	pid_t pid = fork();
+	if (pid < 0)
+	    return casycom_error ("fork: %s", strerror(errno));
+	else if (!pid)
+	    _exit (i+1);
+	app->pid[i] = pid;
+    }
+}
+
+// The exits may arrive in any order, so print them when all are in
+static void App_App_Signal (App* app, unsigned sig, pid_t childPid, int childStatus)
+{
+    if (sig == SIGUSR1) {
+	LOG ("Received SIGUSR1\n");
+	PTimer_Stop (&app->timerp);
+	kill (getpid(), SIGTERM);
+	return;
+    } else if (sig != SIGCHLD) {
+	LOG ("Unexpected signal %s\n", strsignal(sig));
+	return;
+    }
+    for (unsigned i = 0; i < c_NChildren; ++i)
+	if (app->pid[i] == childPid)
+	    app->status[i] = childStatus;
+    if (++app->nExited < c_NChildren)
+	return;
+    for (unsigned i = 0; i < c_NChildren; ++i)
+	LOG ("Child %u exited with code %d\n", i, WEXITSTATUS(app->status[i]));
+    kill (getpid(), SIGUSR1);
+}
+
+static void App_TimerR_Timer (App* app, int fd UNUSED, const Msg* msg UNUSED)
+{
+    LOG ("Timed out with %u of %u children reported\n", app->nExited, c_NChildren);
+    casycom_quit (EXIT_FAILURE);
+}
+
+static const DApp d_App_App = {
+    .interface = &i_App,
+    DMETHOD (App, App_Init),
+    DMETHOD (App, App_Signal)
+};
+static const DTimerR d_App_TimerR = {
+    .interface = &i_TimerR,
+    DMETHOD (App, TimerR_Timer)
+};
+static const Factory f_App = {
+    .Create	= App_Create,
+    .Destroy	= App_Destroy,
+    .dtable	= { &d_App_App, &d_App_TimerR, NULL }
+};
+
+int main (int argc, argv_t argv)
+{
+    casycom_framework_init (&f_App, argc, argv);
+    int ec = casycom_main();
+    LOG ("Quit with exit code %d\n", ec);
+    return ec == 128+SIGTERM ? EXIT_SUCCESS : ec;
+}
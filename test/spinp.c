@@ -0,0 +1,112 @@
+// This file is part of the casycom project
+//
+// Copyright (c) 2015 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "ping.h"
+
+// casycom_set_busy_poll has an idle loop spin for a while before it
+// sleeps in poll, to wake sooner when work arrives. The spin window
+// follows the observed idle gaps, so it is opened by short gaps and
+// closed by a gap longer than the maximum, after which the loop sleeps
+// without spinning. Here pings are delayed first by 1 ms, then 250 ms.
+//
+enum {
+    c_MaxSpinUs = 50000,
+    c_NShort = 20,
+    c_NLong = 3,
+    c_ShortMs = 1,
+    c_LongMs = 250
+};
+
+typedef struct _Echo {
+    Proxy	reply;
+} Echo;
+
+static void* Echo_Create (const Msg* msg)
+{
+    Echo* o = xalloc (sizeof(Echo));
+    o->reply = casycom_create_reply_proxy (&i_PingR, msg);
+    return o;
+}
+
+static void Echo_Ping_Ping (Echo* o, uint32_t v)
+    { PPingR_Ping (&o->reply, v); }
+
+static const DPing d_Echo_Ping = {
+    .interface = &i_Ping,
+    DMETHOD (Echo, Ping_Ping)
+};
+static const Factory f_Echo = {
+    .Create	= Echo_Create,
+    .dtable	= { &d_Echo_Ping, NULL }
+};
+
+//----------------------------------------------------------------------
+
+typedef struct _App {
+    Proxy	echop;
+    uint64_t	spinTime;	// Spin time after the first long gap
+} App;
+
+static void* App_Create (const Msg* msg UNUSED)
+{
+    static App app = {};
+    if (!app.echop.interface) {
+	casycom_register (&f_Echo);
+	app.echop = casycom_create_proxy (&i_Ping, oid_App);
+    }
+    return &app;
+}
+
+static void App_Destroy (void* o UNUSED) {}
+
+static void App_PingLater (App* app, uint32_t v, uint64_t ms)
+{
+    Msg* msg = casymsg_begin (&app->echop, 0, sizeof(v));
+    WStm os = casymsg_write (msg);
+    casystm_write_uint32 (&os, v);
+    casymsg_end_after (msg, ms);
+}
+
+static void App_App_Init (App* app, argc_t argc UNUSED, argv_t argv UNUSED)
+{
+    casycom_set_busy_poll (c_MaxSpinUs);
+    App_PingLater (app, 1, c_ShortMs);
+}
+
+static void App_PingR_Ping (App* app, uint32_t u)
+{
+    const LoopStats st = casycom_loop_stats();
+    if (u < c_NShort)
+	App_PingLater (app, u+1, c_ShortMs);
+    else if (u == c_NShort) {
+	LOG ("After %u short gaps: spun %s, spin window %s\n", c_NShort,
+		st.spinTime ? "yes" : "no", st.spinWindow ? "open" : "closed");
+	App_PingLater (app, u+1, c_LongMs);
+    } else if (u < c_NShort+c_NLong) {
+	if (u == c_NShort+1) {
+	    LOG ("After a long gap: spin window %s\n", st.spinWindow ? "open" : "closed");
+	    app->spinTime = st.spinTime;
+	}
+	App_PingLater (app, u+1, c_LongMs);
+    } else {
+	LOG ("After %u more long gaps: spun %s\n", c_NLong-1, st.spinTime != app->spinTime ? "yes" : "no");
+	casycom_quit (EXIT_SUCCESS);
+    }
+}
+
+static const DApp d_App_App = {
+    .interface = &i_App,
+    DMETHOD (App, App_Init)
+};
+static const DPingR d_App_PingR = {
+    .interface = &i_PingR,
+    DMETHOD (App, PingR_Ping)
+};
+static const Factory f_App = {
+    .Create	= App_Create,
+    .Destroy	= App_Destroy,
+    .dtable	= { &d_App_App, &d_App_PingR, NULL }
+};
+CASYCOM_MAIN (f_App)
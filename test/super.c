@@ -0,0 +1,116 @@
+// This file is part of the casycom project
+//
+// Copyright (c) 2015 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "ping.h"
+
+// An interface may mark methods, which only need the latest value, as
+// supersedable. A newer message to such a method of the same object
+// replaces the undelivered one, which keeps its place in the queue.
+// Here a burst of level updates is delivered once, with the last value,
+// between two marks sent before and after it.
+//
+enum { c_NLevels = 100 };
+
+enum { method_Level_Set, method_Level_Mark };
+typedef void (*MFN_Level_Set)(void* o, uint32_t v);
+typedef void (*MFN_Level_Mark)(void* o, uint32_t v);
+typedef struct _DLevel {
+    const Interface*	interface;
+    MFN_Level_Set	Level_Set;
+    MFN_Level_Mark	Level_Mark;
+} DLevel;
+
+static void Level_Dispatch (const DLevel* dtable, void* o, const Msg* msg)
+{
+    if (msg->imethod == method_Level_Set) {
+	RStm is = casymsg_read (msg);
+	dtable->Level_Set (o, casystm_read_uint32 (&is));
+    } else if (msg->imethod == method_Level_Mark) {
+	RStm is = casymsg_read (msg);
+	dtable->Level_Mark (o, casystm_read_uint32 (&is));
+    } else
+	casymsg_default_dispatch (dtable, o, msg);
+}
+
+static const Interface i_Level = {
+    .name	= "Level",
+    .dispatch	= Level_Dispatch,
+    .supersede	= 1u << method_Level_Set,
+    .method	= { "Set\0u", "Mark\0u", NULL }
+};
+
+static void PLevel_Send (const Proxy* pp, uint32_t imethod, uint32_t v)
+{
+    Msg* msg = casymsg_begin (pp, imethod, sizeof(v));
+    WStm os = casymsg_write (msg);
+    casystm_write_uint32 (&os, v);
+    casymsg_end (msg);
+}
+
+//----------------------------------------------------------------------
+
+typedef struct _Gauge {
+    unsigned	nSets;
+} Gauge;
+
+static void* Gauge_Create (const Msg* msg UNUSED)
+    { return xalloc (sizeof(Gauge)); }
+
+static void Gauge_Level_Set (Gauge* o, uint32_t v)
+    { LOG ("Level set to %u, delivery %u\n", v, ++o->nSets); }
+
+static void Gauge_Level_Mark (Gauge* o UNUSED, uint32_t v)
+{
+    LOG ("Mark %u\n", v);
+    if (v == 2)
+	casycom_quit (EXIT_SUCCESS);
+}
+
+static const DLevel d_Gauge_Level = {
+    .interface = &i_Level,
+    DMETHOD (Gauge, Level_Set),
+    DMETHOD (Gauge, Level_Mark)
+};
+static const Factory f_Gauge = {
+    .Create	= Gauge_Create,
+    .dtable	= { &d_Gauge_Level, NULL }
+};
+
+//----------------------------------------------------------------------
+
+typedef struct _App {
+    Proxy	gaugep;
+} App;
+
+static void* App_Create (const Msg* msg UNUSED)
+{
+    static App app = {};
+    if (!app.gaugep.interface) {
+	casycom_register (&f_Gauge);
+	app.gaugep = casycom_create_proxy (&i_Level, oid_App);
+    }
+    return &app;
+}
+
+static void App_Destroy (void* o UNUSED) {}
+
+static void App_App_Init (App* app, argc_t argc UNUSED, argv_t argv UNUSED)
+{
+    PLevel_Send (&app->gaugep, method_Level_Mark, 1);
+    for (uint32_t i = 1; i <= c_NLevels; ++i)
+	PLevel_Send (&app->gaugep, method_Level_Set, i);
+    PLevel_Send (&app->gaugep, method_Level_Mark, 2);
+}
+
+static const DApp d_App_App = {
+    .interface = &i_App,
+    DMETHOD (App, App_Init)
+};
+static const Factory f_App = {
+    .Create	= App_Create,
+    .Destroy	= App_Destroy,
+    .dtable	= { &d_App_App, NULL }
+};
+CASYCOM_MAIN (f_App)
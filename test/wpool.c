@@ -0,0 +1,183 @@
+// This file is part of the casycom project
+//
+// Copyright (c) 2015 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "ping.h"
+
+// Objects doing lengthy computations can be run on the worker pool
+// instead of the loop thread by flagging their factory. Such objects
+// may only send messages from their methods, and can not create proxies
+// except in the constructor, which always runs on the loop thread.
+//
+// A factory_Serialized object receives its messages in order, one at
+// a time, so it can keep state without locking. This summer adds up
+// the pinged values and replies with the running sum.
+//
+typedef struct _Summer {
+    Proxy	reply;
+    uint32_t	sum;
+} Summer;
+
+static void* Summer_Create (const Msg* msg)
+{
+    LOG ("Created Summer %u\n", msg->h.dest);
+    Summer* o = xalloc (sizeof(Summer));
+    o->reply = casycom_create_reply_proxy (&i_PingR, msg);
+    return o;
+}
+
+static void Summer_Ping_Ping (Summer* o, uint32_t u)
+{
+    // Printing here would race with the app, so just reply
+    o->sum += u;
+    PPingR_Ping (&o->reply, o->sum);
+}
+
+static const DPing d_Summer_Ping = {
+    .interface = &i_Ping,
+    DMETHOD (Summer, Ping_Ping)
+};
+static const Factory f_Summer = {
+    .Create	= Summer_Create,
+    .flags	= factory_Serialized,
+    .dtable	= { &d_Summer_Ping, NULL }
+};
+
+// A factory_Reentrant object may receive several messages at once on
+// different worker threads, so it must not modify its state. Replies
+// will come back in no particular order. Objects are created by the
+// factory of the interface, so the squarer needs its own interfaces.
+//
+typedef void (*MFN_Square_Square)(void* o, uint32_t v);
+typedef struct _DSquare {
+    const Interface*	interface;
+    MFN_Square_Square	Square_Square;
+} DSquare;
+
+static void Square_Dispatch (const DSquare* dtable, void* o, const Msg* msg)
+{
+    if (msg->imethod == 0) {
+	RStm is = casymsg_read (msg);
+	dtable->Square_Square (o, casystm_read_uint32 (&is));
+    } else
+	casymsg_default_dispatch (dtable, o, msg);
+}
+
+static const Interface i_Square = {
+    .name	= "Square",
+    .dispatch	= Square_Dispatch,
+    .method	= { "Square\0u", NULL }
+};
+static const Interface i_SquareR = {
+    .name	= "SquareR",
+    .dispatch	= Square_Dispatch,
+    .method	= { "Square\0u", NULL }
+};
+
+static void PSquare_Square (const Proxy* pp, uint32_t v)
+{
+    Msg* msg = casymsg_begin (pp, 0, sizeof(v));
+    WStm os = casymsg_write (msg);
+    casystm_write_uint32 (&os, v);
+    casymsg_end (msg);
+}
+
+typedef struct _Squarer {
+    Proxy	reply;
+} Squarer;
+
+static void* Squarer_Create (const Msg* msg)
+{
+    LOG ("Created Squarer %u\n", msg->h.dest);
+    Squarer* o = xalloc (sizeof(Squarer));
+    o->reply = casycom_create_reply_proxy (&i_SquareR, msg);
+    return o;
+}
+
+static void Squarer_Square_Square (Squarer* o, uint32_t u)
+    { PSquare_Square (&o->reply, u*u); }
+
+static const DSquare d_Squarer_Square = {
+    .interface = &i_Square,
+    DMETHOD (Squarer, Square_Square)
+};
+static const Factory f_Squarer = {
+    .Create	= Squarer_Create,
+    .flags	= factory_Reentrant,
+    .dtable	= { &d_Squarer_Square, NULL }
+};
+
+//----------------------------------------------------------------------
+
+enum { c_NPings = 8 };
+
+typedef struct _App {
+    Proxy	summer;
+    Proxy	squarer;
+    unsigned	nSums;
+    unsigned	nSquares;
+    uint32_t	squareSum;
+} App;
+
+static void* App_Create (const Msg* msg UNUSED)
+{
+    static App app = {};
+    if (!app.summer.interface) {
+	casycom_register (&f_Summer);
+	app.summer = casycom_create_proxy (&i_Ping, oid_App);
+	casycom_register (&f_Squarer);
+	app.squarer = casycom_create_proxy (&i_Square, oid_App);
+    }
+    return &app;
+}
+
+static void App_Destroy (void* o UNUSED) {}
+
+static void App_App_Init (App* app, argc_t argc UNUSED, argv_t argv UNUSED)
+{
+    for (uint32_t i = 1; i <= c_NPings; ++i) {
+	PPing_Ping (&app->summer, i);
+	PSquare_Square (&app->squarer, i);
+    }
+}
+
+static void App_CheckDone (App* app)
+{
+    if (app->nSums == c_NPings && app->nSquares == c_NPings) {
+	LOG ("Received %u squares, adding up to %u\n", app->nSquares, app->squareSum);
+	casycom_quit (EXIT_SUCCESS);
+    }
+}
+
+static void App_PingR_Ping (App* app, uint32_t u)
+{
+    LOG ("Sum %u: %u\n", ++app->nSums, u);
+    App_CheckDone (app);
+}
+
+static void App_Square_Square (App* app, uint32_t u)
+{
+    ++app->nSquares;
+    app->squareSum += u;
+    App_CheckDone (app);
+}
+
+static const DApp d_App_App = {
+    .interface = &i_App,
+    DMETHOD (App, App_Init)
+};
+static const DPingR d_App_PingR = {
+    .interface = &i_PingR,
+    DMETHOD (App, PingR_Ping)
+};
+static const DSquare d_App_SquareR = {
+    .interface = &i_SquareR,
+    DMETHOD (App, Square_Square)
+};
+static const Factory f_App = {
+    .Create	= App_Create,
+    .Destroy	= App_Destroy,
+    .dtable	= { &d_App_App, &d_App_PingR, &d_App_SquareR, NULL }
+};
+CASYCOM_MAIN (f_App)
@@ -0,0 +1,95 @@
+// This file is part of the casycom project
+//
+// Copyright (c) 2015 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "ping.h"
+
+// Each loop round normally delivers all queued messages before polling
+// fds and timers. A dispatch budget, set by casycom_set_dispatch_budget,
+// ends the round after the given number of messages, or microseconds,
+// so the loop polls between parts of a long queue. Here a readable
+// pipe is reported after the first round of a large batch of pings.
+//
+enum {
+    c_NPings = 10000,
+    c_Budget = 1000
+};
+
+static unsigned _nPings = 0;	// Delivered to the Counter
+
+static void* Counter_Create (const Msg* msg UNUSED)
+    { return xalloc (1); }
+
+static void Counter_Ping_Ping (void* o UNUSED, uint32_t v UNUSED)
+{
+    if (++_nPings == c_NPings) {
+	LOG ("All %u pings delivered\n", _nPings);
+	casycom_quit (EXIT_SUCCESS);
+    }
+}
+
+static const DPing d_Counter_Ping = {
+    .interface = &i_Ping,
+    DMETHOD (Counter, Ping_Ping)
+};
+static const Factory f_Counter = {
+    .Create	= Counter_Create,
+    .dtable	= { &d_Counter_Ping, NULL }
+};
+
+//----------------------------------------------------------------------
+
+typedef struct _App {
+    Proxy	counterp;
+    Proxy	timerp;
+    int		pipefd [2];
+} App;
+
+static void* App_Create (const Msg* msg UNUSED)
+{
+    static App app = {};
+    if (!app.counterp.interface) {
+	casycom_register (&f_Timer);
+	casycom_register (&f_Counter);
+	app.counterp = casycom_create_proxy (&i_Ping, oid_App);
+	app.timerp = casycom_create_proxy (&i_Timer, oid_App);
+    }
+    return &app;
+}
+
+static void App_Destroy (void* vo)
+{
+    App* app = vo;
+    for (unsigned i = 0; i < ArraySize(app->pipefd); ++i)
+	close (app->pipefd[i]);
+}
+
+static void App_App_Init (App* app, argc_t argc UNUSED, argv_t argv UNUSED)
+{
+    casycom_set_dispatch_budget (c_Budget, 0);
+    // The pipe is readable at once, but is only polled between rounds
+    if (0 > pipe (app->pipefd) || 1 != write (app->pipefd[1], "", 1))
+	return casycom_error ("pipe: %s", strerror(errno));
+    PTimer_WaitRead (&app->timerp, app->pipefd[0]);
+    for (uint32_t i = 0; i < c_NPings; ++i)
+	PPing_Ping (&app->counterp, i);
+}
+
+static void App_TimerR_Timer (App* app UNUSED, int fd UNUSED, const Msg* msg UNUSED)
+    { LOG ("Pipe readable after %u of %u pings\n", _nPings, c_NPings); }
+
+static const DApp d_App_App = {
+    .interface = &i_App,
+    DMETHOD (App, App_Init)
+};
+static const DTimerR d_App_TimerR = {
+    .interface = &i_TimerR,
+    DMETHOD (App, TimerR_Timer)
+};
+static const Factory f_App = {
+    .Create	= App_Create,
+    .Destroy	= App_Destroy,
+    .dtable	= { &d_App_App, &d_App_TimerR, NULL }
+};
+CASYCOM_MAIN (f_App)
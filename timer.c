@@ -7,6 +7,8 @@
 #include "main.h"
 #include "vector.h"
 #include <time.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 
 //----------------------------------------------------------------------
 // Timer interface
@@ -39,6 +41,7 @@ static void Timer_Dispatch (const DTimer* dtable, void* o, const Msg* msg)
 const Interface i_Timer = {
     .name	= "Timer",
     .dispatch	= Timer_Dispatch,
+    .supersede	= 1<<method_Timer_Watch,	// Only the last watch command matters
     .method	= { "Watch\0uix", NULL }
 };
 
@@ -68,6 +71,7 @@ static void TimerR_Dispatch (const DTimerR* dtable, void* o, const Msg* msg)
 const Interface i_TimerR = {
     .name	= "TimerR",
     .dispatch	= TimerR_Dispatch,
+    .priority	= priority_High,
     .method	= { "Timer\0i", NULL }
 };
 
@@ -79,11 +83,21 @@ typedef struct _Timer {
     casytimer_t		nextfire;
     enum ETimerWatchCmd	cmd;
     int			fd;
+    int			efd;	// fd registered with the embedding epoll, or -1
 } Timer;
 
-// Global list of pointers to active timer objects
+// List of pointers to active timer objects in this loop shard
 DECLARE_VECTOR_TYPE (WatchList, Timer*);
-static VECTOR(WatchList, _timer_WatchList);
+static _Thread_local VECTOR(WatchList, _timer_WatchList);
+
+// When the loop is embedded, watched fds are kept registered with an
+// epoll fd as watches change, and a timerfd registered with it expires
+// at the nearest timer, so the host loop only needs to poll one fd.
+static _Thread_local int _timer_EpollFd = -1;
+static _Thread_local int _timer_TimerFd = -1;
+
+static void Timer_EpollAdd (Timer* o);
+static void Timer_EpollRemove (Timer* o);
 
 //----------------------------------------------------------------------
 
@@ -94,6 +108,7 @@ void* Timer_Create (const Msg* msg)
     o->nextfire = TIMER_NONE;
     o->cmd = WATCH_STOP;
     o->fd = -1;
+    o->efd = -1;
     vector_push_back (&_timer_WatchList, &o);
     return o;
 }
@@ -101,6 +116,7 @@ void* Timer_Create (const Msg* msg)
 void Timer_Destroy (void* vo)
 {
     Timer* o = vo;
+    Timer_EpollRemove (o);
     for (int i = _timer_WatchList.size; --i >= 0;)
 	if (_timer_WatchList.d[i] == o)
 	    vector_erase (&_timer_WatchList, i);
@@ -111,11 +127,13 @@ void Timer_Destroy (void* vo)
 
 void Timer_Timer_Watch (Timer* o, enum ETimerWatchCmd cmd, int fd, casytimer_t timeoutms)
 {
+    Timer_EpollRemove (o);
     o->cmd = cmd;
     o->fd = fd;
     if (timeoutms <= TIMER_MAX)
 	timeoutms += Timer_NowMS();
     o->nextfire = timeoutms;
+    Timer_EpollAdd (o);
 }
 
 #ifndef NDEBUG
@@ -134,13 +152,20 @@ static const char* timestring (casytimer_t t)
 #endif
 
 /// Waits for timer or fd events.
-/// toWait specifies the minimum timeout in milliseconds.
+/// toWait is the longest wait in milliseconds, shortened to the nearest
+/// timer. 0 only checks for events, and -1 waits for the nearest timer
+/// or event without a limit.
 bool Timer_RunTimer (int toWait)
 {
-    if (!_timer_WatchList.size)
-	return false;
+    // Signals are polled with the watched fds, and checked even without any
+    const int sigfd = casycom_signal_fd();
+    if (!_timer_WatchList.size) {
+	if (sigfd < 0)
+	    return false;
+	toWait = 0;
+    }
     // Populate the fd list and find the nearest timer
-    struct pollfd fds [_timer_WatchList.size];
+    struct pollfd fds [_timer_WatchList.size+2];	// +2 for the signal and wakeup fds
     size_t nFds = 0;
     casytimer_t nearest = TIMER_MAX;
     for (size_t i = 0; i < _timer_WatchList.size; ++i) {
@@ -154,9 +179,27 @@ bool Timer_RunTimer (int toWait)
 	    ++nFds;
 	}
     }
-    // Calculate how long to wait
-    if (toWait && nearest < TIMER_MAX)	// toWait could be zero, in which case don't
-	toWait = nearest - Timer_NowMS();
+    // Calculate how long to wait; a positive toWait is the longest wait
+    if (toWait && nearest < TIMER_MAX) {	// toWait could be zero, in which case don't
+	const casytimer_t now = Timer_NowMS();
+	const casytimer_t untilNearest = nearest > now ? nearest - now : 0;
+	if (toWait < 0 || untilNearest < (casytimer_t) toWait)
+	    toWait = untilNearest;
+    }
+    size_t nPolled = nFds;
+    if (sigfd >= 0) {
+	fds[nPolled].fd = sigfd;
+	fds[nPolled].events = POLLIN;
+	fds[nPolled++].revents = 0;
+    }
+    // Messages queued by other threads wake the loop through the wakeup fd
+    const bool sleeping = toWait && casycom_begin_sleep();
+    if (sleeping) {
+	fds[nPolled].fd = casycom_wakeup_fd();
+	fds[nPolled].events = POLLIN;
+	fds[nPolled++].revents = 0;
+    } else
+	toWait = 0;
     // And wait
     if (DEBUG_MSG_TRACE) {
 	DEBUG_PRINTF ("[I] Waiting for %zu file descriptors from %zu timers", nFds, _timer_WatchList.size);
@@ -165,7 +208,11 @@ bool Timer_RunTimer (int toWait)
 	DEBUG_PRINTF (". %s\n", timestring(Timer_NowMS()));
     }
     // And poll
-    poll (fds, nFds, toWait);
+    poll (fds, nPolled, toWait);
+    if (sleeping)
+	casycom_end_sleep (fds[nPolled-1].revents & POLLIN);
+    if (sigfd >= 0 && (fds[nFds].revents & POLLIN))
+	casycom_read_signals();
     // Poll errors are checked for each fd with POLLERR. Other errors are ignored.
     // poll will exit when there are fds available or when the timer expires
     const casytimer_t now = Timer_NowMS();
@@ -227,6 +274,119 @@ size_t Timer_WatchListForPoll (struct pollfd* fds, size_t fdslen, int* timeout)
     return nFds;
 }
 
+//----------------------------------------------------------------------
+// Embedding epoll
+
+static void Timer_EpollAdd (Timer* o)
+{
+    if (_timer_EpollFd < 0 || o->fd < 0 || !(o->cmd & WATCH_RDWR))
+	return;
+    struct epoll_event ev = { .events = o->cmd & WATCH_RDWR, .data.ptr = o };
+    if (0 > epoll_ctl (_timer_EpollFd, EPOLL_CTL_ADD, o->fd, &ev)) {
+	// An fd can only be added once, so other watches of it add a duplicate
+	int dfd = -1;
+	if (errno != EEXIST || 0 > (dfd = dup (o->fd)) || 0 > epoll_ctl (_timer_EpollFd, EPOLL_CTL_ADD, dfd, &ev)) {
+	    casycom_error ("epoll_ctl: %s", strerror(errno));
+	    if (dfd >= 0)
+		close (dfd);
+	    return;
+	}
+	o->efd = dfd;
+    } else
+	o->efd = o->fd;
+}
+
+static void Timer_EpollRemove (Timer* o)
+{
+    if (o->efd < 0)
+	return;
+    // The fd may already be closed, removing it from epoll
+    epoll_ctl (_timer_EpollFd, EPOLL_CTL_DEL, o->efd, NULL);
+    if (o->efd != o->fd)
+	close (o->efd);
+    o->efd = -1;
+}
+
+/// Returns the embedding epoll fd, creating it if needed. It includes
+/// watched fds, a timerfd for timers, and \p wakefd for messages.
+int Timer_EpollFd (int wakefd)
+{
+    if (_timer_EpollFd >= 0)
+	return _timer_EpollFd;
+    if (0 > (_timer_EpollFd = epoll_create1 (EPOLL_CLOEXEC))
+	    || 0 > (_timer_TimerFd = timerfd_create (CLOCK_REALTIME, TFD_NONBLOCK| TFD_CLOEXEC))
+	    || 0 > epoll_ctl (_timer_EpollFd, EPOLL_CTL_ADD, _timer_TimerFd, &(struct epoll_event){ .events = EPOLLIN, .data.ptr = &_timer_TimerFd })
+	    || 0 > epoll_ctl (_timer_EpollFd, EPOLL_CTL_ADD, wakefd, &(struct epoll_event){ .events = EPOLLIN, .data.ptr = NULL })
+	    || (casycom_signal_fd() >= 0 && 0 > epoll_ctl (_timer_EpollFd, EPOLL_CTL_ADD, casycom_signal_fd(), &(struct epoll_event){ .events = EPOLLIN, .data.ptr = &_timer_EpollFd }))) {
+	casycom_log (LOG_ERR, "failed to create the embedding epoll fd: %s\n", strerror(errno));
+	Timer_EpollClose();
+	return -1;
+    }
+    for (size_t i = 0; i < _timer_WatchList.size; ++i)
+	Timer_EpollAdd (_timer_WatchList.d[i]);
+    return _timer_EpollFd;
+}
+
+/// Closes the embedding epoll fd
+void Timer_EpollClose (void)
+{
+    for (size_t i = 0; i < _timer_WatchList.size; ++i)
+	Timer_EpollRemove (_timer_WatchList.d[i]);
+    if (_timer_TimerFd >= 0)
+	close (_timer_TimerFd);
+    if (_timer_EpollFd >= 0)
+	close (_timer_EpollFd);
+    _timer_TimerFd = _timer_EpollFd = -1;
+}
+
+// Fired watches stay in the list until destroyed in the next idle
+static void Timer_EpollFire (Timer* o)
+{
+    PTimerR_Timer (&o->reply, o->fd);
+    casycom_mark_unused (o);
+    Timer_EpollRemove (o);
+    o->cmd = WATCH_STOP;
+    o->nextfire = TIMER_NONE;
+}
+
+/// Fires watches with ready fds or expired timers, without waiting
+void Timer_EpollRun (void)
+{
+    struct epoll_event evs [64];	// More will be returned by the next call
+    const int n = epoll_wait (_timer_EpollFd, evs, ArraySize(evs), 0);
+    for (int i = 0; i < n; ++i) {
+	if (evs[i].data.ptr == &_timer_TimerFd) {
+	    uint64_t nExpired;
+	    if (0 > read (_timer_TimerFd, &nExpired, sizeof(nExpired)))
+		DEBUG_PRINTF ("[I] timerfd was already read: %s\n", strerror(errno));
+	} else if (evs[i].data.ptr == &_timer_EpollFd)
+	    casycom_read_signals();
+	else if (evs[i].data.ptr)
+	    Timer_EpollFire (evs[i].data.ptr);
+    }
+    const casytimer_t now = Timer_NowMS();
+    for (size_t i = 0; i < _timer_WatchList.size; ++i)
+	if (_timer_WatchList.d[i]->nextfire <= now)
+	    Timer_EpollFire (_timer_WatchList.d[i]);
+}
+
+/// Sets the timerfd to expire at the nearest timer, or at \p nearest
+void Timer_EpollArm (casytimer_t nearest)
+{
+    for (size_t i = 0; i < _timer_WatchList.size; ++i)
+	if (_timer_WatchList.d[i]->nextfire < nearest)
+	    nearest = _timer_WatchList.d[i]->nextfire;
+    struct itimerspec t = {};	// Zero disarms
+    if (nearest < TIMER_MAX) {
+	t.it_value.tv_sec = nearest / 1000;
+	t.it_value.tv_nsec = nearest % 1000 * 1000000 + 1;	// Nonzero even at the epoch
+    }
+    if (0 > timerfd_settime (_timer_TimerFd, TFD_TIMER_ABSTIME, &t, NULL))
+	casycom_log (LOG_ERR, "timerfd_settime: %s\n", strerror(errno));
+}
+
+//----------------------------------------------------------------------
+
 /// Returns current time in milliseconds
 casytimer_t Timer_NowMS (void)
 {
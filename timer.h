@@ -67,6 +67,11 @@ bool		Timer_RunTimer (int toWait) noexcept;
 casytimer_t	Timer_NowMS (void) noexcept;
 size_t		Timer_WatchListSize (void) noexcept;
 size_t		Timer_WatchListForPoll (struct pollfd* fds, size_t fdslen, int* timeout) noexcept NONNULL(1);
+// Embedding epoll fd support for casycom_embed_fd. Do not use directly.
+int		Timer_EpollFd (int wakefd) noexcept;
+void		Timer_EpollClose (void) noexcept;
+void		Timer_EpollRun (void) noexcept;
+void		Timer_EpollArm (casytimer_t nearest) noexcept;
 
 //----------------------------------------------------------------------
 // PTimer inlines
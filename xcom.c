@@ -5,6 +5,7 @@
 
 #include "xcom.h"
 #include "timer.h"
+#include "child.h"
 #include <fcntl.h>
 #include <sys/un.h>
 #include <paths.h>
@@ -199,7 +200,7 @@ int PExtern_ConnectUserLocal (const Proxy* pp, const char* sockname, const iid_t
     return PExtern_Connect (pp, (const struct sockaddr*) &addr, sizeof(addr), importedInterfaces);
 }
 
-int PExtern_LaunchPipe (const Proxy* pp, const char* exe, const char* arg, const iid_t* importedInterfaces)
+static int Extern_LaunchPipe (const Proxy* pp, const char* exe, const char* arg, const iid_t* importedInterfaces, pid_t* pid)
 {
     // Check if executable exists before the fork to allow proper error handling
     char exepath [PATH_MAX];
@@ -224,6 +225,7 @@ int PExtern_LaunchPipe (const Proxy* pp, const char* exe, const char* arg, const
     if (fr == 0) {	// Server side
 	close (socks[socket_ClientSide]);
 	dup2 (socks[socket_ServerSide], STDIN_FILENO);
+	casycom_restore_signal_mask();
 	execl (exefp, exe, arg, NULL);
 
 	// If exec failed, log the error and exit
@@ -233,10 +235,27 @@ int PExtern_LaunchPipe (const Proxy* pp, const char* exe, const char* arg, const
     } else {		// Client side
 	close (socks[socket_ServerSide]);
 	PExtern_Open (pp, socks[socket_ClientSide], EXTERN_CLIENT, importedInterfaces, NULL);
+	*pid = fr;
     }
     return socks[0];
 }
 
+int PExtern_LaunchPipe (const Proxy* pp, const char* exe, const char* arg, const iid_t* importedInterfaces)
+{
+    pid_t pid;
+    return Extern_LaunchPipe (pp, exe, arg, importedInterfaces, &pid);
+}
+
+/// Launches the server like PExtern_LaunchPipe and watches its exit with Child proxy \p childp
+int PExtern_LaunchPipeWatched (const Proxy* pp, const Proxy* childp, const char* exe, const char* arg, const iid_t* importedInterfaces)
+{
+    pid_t pid;
+    int fd = Extern_LaunchPipe (pp, exe, arg, importedInterfaces, &pid);
+    if (fd >= 0)
+	PChild_Watch (childp, pid);
+    return fd;
+}
+
 //}}}-------------------------------------------------------------------
 //{{{ PExternR
 
@@ -278,6 +297,25 @@ DECLARE_VECTOR_TYPE (MsgVector, Msg*);
 
 enum { MAX_MSG_HEADER_SIZE = UINT8_MAX-8 };
 
+#if CASYCOM_WIDE_OIDS
+// Wide oids use the wide header, with 32-bit extids. Both ends
+// of the connection must be built with the same oid width.
+enum {
+    extid_COM,
+    extid_ClientBase = extid_COM,
+    extid_ServerBase = extid_ClientBase+(1 << (oid_IndexBits+oid_GenBits)),	// above all wide oids
+    extid_ClientLast = extid_ServerBase-1,
+    extid_ServerLast = INT32_MAX
+};
+
+typedef struct _ExtMsgHeader {
+    uint32_t	sz;		///< Message body size, aligned to c_MsgAlignment
+    uint32_t	extid;		///< Destination node iid
+    uint8_t	fdoffset;	///< Offset to file descriptor in message body, if passing
+    uint8_t	hsz;		///< Full size of header
+    uint8_t	reserved [6];	///< Pads the header to MESSAGE_HEADER_ALIGNMENT
+} ExtMsgHeader;
+#else
 enum {
     extid_COM,
     extid_ClientBase = extid_COM,		// Set these up to be equal to COMRelay nodeid on the client
@@ -292,6 +330,7 @@ typedef struct _ExtMsgHeader {
     uint8_t	fdoffset;	///< Offset to file descriptor in message body, if passing
     uint8_t	hsz;		///< Full size of header
 } ExtMsgHeader;
+#endif
 
 typedef union _ExtMsgHeaderBuf {
     ExtMsgHeader	h;
@@ -300,7 +339,7 @@ typedef union _ExtMsgHeaderBuf {
 
 typedef struct _COMConn {
     Proxy	proxy;
-    uint16_t	extid;
+    oid_t	extid;
 } COMConn;
 
 DECLARE_VECTOR_TYPE (COMConnVector, COMConn);
@@ -324,11 +363,11 @@ typedef struct _Extern {
 } Extern;
 
 DECLARE_VECTOR_TYPE (ExternsVector, Extern*);
-static VECTOR (ExternsVector, _Extern_Externs);
+static _Thread_local VECTOR (ExternsVector, _Extern_Externs);
 
 //----------------------------------------------------------------------
 
-static COMConn* Extern_COMConnByExtid (Extern* o, uint16_t extid);
+static COMConn* Extern_COMConnByExtid (Extern* o, oid_t extid);
 static bool Extern_IsInterfaceExported (const Extern* o, iid_t iid);
 static bool Extern_IsValidSocket (Extern* o);
 static bool Extern_ValidateMessage (Extern* o, Msg* msg);
@@ -569,7 +608,7 @@ static void Extern_Reading (Extern* o)
 	int br = recvmsg (o->fd, &mh, 0);
 	if (br <= 0) {
 	    if (!br || errno == ECONNRESET)	// br == 0 when remote end closes. No error then, just need to close this end too.
-		DEBUG_PRINTF ("[X] %hu.Extern: rsocket %d closed by the other end\n", o->info.oid, o->fd);
+		DEBUG_PRINTF ("[X] %u.Extern: rsocket %d closed by the other end\n", o->info.oid, o->fd);
 	    else {
 		if (errno == EINTR)
 		    continue;
@@ -660,7 +699,7 @@ static bool Extern_ValidateMessageHeader (const Extern* o UNUSED, const ExtMsgHe
     return true;
 }
 
-static COMConn* Extern_COMConnByExtid (Extern* o, uint16_t extid)
+static COMConn* Extern_COMConnByExtid (Extern* o, oid_t extid)
 {
     for (size_t i = 0; i < o->conns.size; ++i)
 	if (o->conns.d[i].extid == extid)
@@ -689,6 +728,7 @@ static bool Extern_ValidateMessage (Extern* o, Msg* msg)
 	DEBUG_PRINTF ("[X] Invalid method index in message\n");
 	return false;
     }
+    msg->priority = priority_Normal;	// Messages from a connection are delivered in the order sent
     // And validate the message body by signature
     size_t vmsize = casymsg_validate_signature (msg);
     if (Align (vmsize, MESSAGE_BODY_ALIGNMENT) != msg->size) {	// Written size must be the aligned real size
@@ -711,7 +751,7 @@ static bool Extern_ValidateMessage (Extern* o, Msg* msg)
     if (!conn) {		// If not present, then this is a request to create one
 	// Do not create object for COM messages (such as COM Delete)
 	if (msg->h.interface == &i_COM) {
-	    DEBUG_PRINTF ("[X] Ignoring COM message to extid %hu\n", msg->extid);
+	    DEBUG_PRINTF ("[X] Ignoring COM message to extid %u\n", msg->extid);
 	    casymsg_free (msg);
 	    o->inMsg = NULL;	// to skip QueueIncomingMessage in caller
 	    return true;
@@ -732,7 +772,7 @@ static bool Extern_ValidateMessage (Extern* o, Msg* msg)
 	// The remote end sets the extid
 	conn->extid = msg->extid;
 	PCOM_CreateObject (&conn->proxy);
-	DEBUG_PRINTF ("[X] New incoming connection %hu -> %hu.%s, extid %hu\n", conn->proxy.src, conn->proxy.dest, casymsg_interface_name(msg), conn->extid);
+	DEBUG_PRINTF ("[X] New incoming connection %u -> %u.%s, extid %u\n", conn->proxy.src, conn->proxy.dest, casymsg_interface_name(msg), conn->extid);
     }
     // Translate the extid into local addresses
     msg->h.src = conn->proxy.src;
@@ -746,7 +786,7 @@ static void Extern_QueueIncomingMessage (Extern* o, Msg* msg)
 	PCOM_Dispatch (&d_Extern_COM, o, msg);
 	casymsg_free (msg);
     } else {
-	DEBUG_PRINTF ("[X] Queueing incoming message[%u] %hu -> %hu.%s.%s\n", msg->size, msg->h.src, msg->h.dest, casymsg_interface_name(msg), casymsg_method_name(msg));
+	DEBUG_PRINTF ("[X] Queueing incoming message[%u] %u -> %u.%s.%s\n", msg->size, msg->h.src, msg->h.dest, casymsg_interface_name(msg), casymsg_method_name(msg));
 	casymsg_end (msg);
     }
 }
@@ -808,12 +848,12 @@ static void Extern_QueueOutgoingMessage (Extern* o, Msg* msg)
 	    conn->proxy = casycom_create_proxy_to (&i_COM, o->info.oid, msg->h.dest);
 	    // Extids are assigned from oid with side-based offset
 	    conn->extid = msg->h.dest + (o->info.isClient ? extid_ClientBase : extid_ServerBase);
-	    DEBUG_PRINTF ("[X] New outgoing connection %hu -> %hu.%s, extid %hu\n", msg->h.src, msg->h.dest, casymsg_interface_name(msg), conn->extid);
+	    DEBUG_PRINTF ("[X] New outgoing connection %u -> %u.%s, extid %u\n", msg->h.src, msg->h.dest, casymsg_interface_name(msg), conn->extid);
 	}
 	msg->extid = conn->extid;
 	// Once the object is deleted, the COMConn record must be recreated because it is linked to a specific object interface
 	if (msg->h.interface == &i_COM && msg->imethod == method_COM_Delete) {
-	    DEBUG_PRINTF ("[X] Destroying connection with extid %hu\n", conn->extid);
+	    DEBUG_PRINTF ("[X] Destroying connection with extid %u\n", conn->extid);
 	    vector_erase (&o->conns, conn - o->conns.d);
 	}
     }
@@ -870,7 +910,7 @@ static bool Extern_Writing (Extern* o)
 	int bw = sendmsg (o->fd, &mh, MSG_NOSIGNAL);
 	if (bw <= 0) {
 	    if (!bw || errno == ECONNRESET)	// bw == 0 when remote end closes. No error then, just need to close this end too.
-		DEBUG_PRINTF ("[X] %hu.Extern: wsocket %d closed by the other end\n", o->info.oid, o->fd);
+		DEBUG_PRINTF ("[X] %u.Extern: wsocket %d closed by the other end\n", o->info.oid, o->fd);
 	    else {
 		if (errno == EINTR)
 		    continue;
@@ -36,6 +36,7 @@ int  PExtern_ConnectLocal (const Proxy* pp, const char* path, const iid_t* impor
 int  PExtern_ConnectUserLocal (const Proxy* pp, const char* sockname, const iid_t* importedInterfaces) noexcept NONNULL();
 int  PExtern_ConnectSystemLocal (const Proxy* pp, const char* sockname, const iid_t* importedInterfaces) noexcept NONNULL();
 int  PExtern_LaunchPipe (const Proxy* pp, const char* exe, const char* arg, const iid_t* importedInterfaces) noexcept NONNULL(1,2,4);
+int  PExtern_LaunchPipeWatched (const Proxy* pp, const Proxy* childp, const char* exe, const char* arg, const iid_t* importedInterfaces) noexcept NONNULL(1,2,3,5);
 
 extern const Interface i_Extern;
 